@@ -3,10 +3,16 @@
 #include <mol/node/common.hpp>
 #include <mol/node/stats.hpp>
 
+#include <ed25519-donna/ed25519.h>
+
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace
 {
 /**
- * Roll back the visited block
+ * Roll back the visited block, blocks depending on it must have been rolled back already
  */
 class rollback_visitor : public mol::block_visitor
 {
@@ -22,17 +28,17 @@ public:
 		auto hash (block_a.hash ());
 		mol::pending_info pending;
 		mol::pending_key key (block_a.hashables.destination, hash);
-		while (ledger.store.pending_get (transaction, key, pending))
-		{
-			ledger.rollback (transaction, ledger.latest (transaction, block_a.hashables.destination));
-		}
+		auto received (ledger.store.pending_get (transaction, key, pending));
+		assert (!received);
 		mol::account_info info;
 		auto error (ledger.store.account_get (transaction, pending.source, info));
 		assert (!error);
-		ledger.store.pending_del (transaction, key);
-		ledger.store.representation_add (transaction, ledger.representative (transaction, hash), pending.amount.number ());
+		ledger.pending_del (transaction, key);
+		ledger.representation_add (transaction, ledger.representative (transaction, hash), pending.amount.number ());
 		ledger.change_latest (transaction, pending.source, block_a.hashables.previous, info.rep_block, ledger.balance (transaction, block_a.hashables.previous), info.block_count - 1);
 		ledger.store.block_del (transaction, hash);
+		ledger.sideband_del (transaction, hash);
+		ledger.height_del (transaction, pending.source, 0, info.block_count);
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, pending.source);
 		ledger.store.block_successor_clear (transaction, block_a.hashables.previous);
@@ -52,10 +58,12 @@ public:
 		mol::account_info info;
 		auto error (ledger.store.account_get (transaction, destination_account, info));
 		assert (!error);
-		ledger.store.representation_add (transaction, ledger.representative (transaction, hash), 0 - amount);
+		ledger.representation_add (transaction, ledger.representative (transaction, hash), 0 - amount);
 		ledger.change_latest (transaction, destination_account, block_a.hashables.previous, representative, ledger.balance (transaction, block_a.hashables.previous), info.block_count - 1);
 		ledger.store.block_del (transaction, hash);
-		ledger.store.pending_put (transaction, mol::pending_key (destination_account, block_a.hashables.source), { source_account, amount });
+		ledger.sideband_del (transaction, hash);
+		ledger.height_del (transaction, destination_account, 0, info.block_count);
+		ledger.pending_put (transaction, mol::pending_key (destination_account, block_a.hashables.source), { source_account, amount });
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, destination_account);
 		ledger.store.block_successor_clear (transaction, block_a.hashables.previous);
@@ -71,10 +79,12 @@ public:
 		auto amount (ledger.amount (transaction, block_a.hashables.source));
 		auto destination_account (ledger.account (transaction, hash));
 		auto source_account (ledger.account (transaction, block_a.hashables.source));
-		ledger.store.representation_add (transaction, ledger.representative (transaction, hash), 0 - amount);
+		ledger.representation_add (transaction, ledger.representative (transaction, hash), 0 - amount);
 		ledger.change_latest (transaction, destination_account, 0, 0, 0, 0);
 		ledger.store.block_del (transaction, hash);
-		ledger.store.pending_put (transaction, mol::pending_key (destination_account, block_a.hashables.source), { source_account, amount });
+		ledger.sideband_del (transaction, hash);
+		ledger.height_del (transaction, destination_account, 0, 1);
+		ledger.pending_put (transaction, mol::pending_key (destination_account, block_a.hashables.source), { source_account, amount });
 		ledger.store.frontier_del (transaction, hash);
 		ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::open);
 	}
@@ -87,9 +97,11 @@ public:
 		auto error (ledger.store.account_get (transaction, account, info));
 		assert (!error);
 		auto balance (ledger.balance (transaction, block_a.hashables.previous));
-		ledger.store.representation_add (transaction, representative, balance);
-		ledger.store.representation_add (transaction, hash, 0 - balance);
+		ledger.representation_add (transaction, representative, balance);
+		ledger.representation_add (transaction, hash, 0 - balance);
 		ledger.store.block_del (transaction, hash);
+		ledger.sideband_del (transaction, hash);
+		ledger.height_del (transaction, account, 0, info.block_count);
 		ledger.change_latest (transaction, account, block_a.hashables.previous, representative, info.balance, info.block_count - 1);
 		ledger.store.frontier_del (transaction, hash);
 		ledger.store.frontier_put (transaction, block_a.hashables.previous, account);
@@ -111,27 +123,24 @@ public:
 		auto balance (ledger.balance (transaction, block_a.hashables.previous));
 		auto is_send (block_a.hashables.balance < balance);
 		// Add in amount delta
-		ledger.store.representation_add (transaction, hash, 0 - block_a.hashables.balance.number ());
+		ledger.representation_add (transaction, hash, 0 - block_a.hashables.balance.number ());
 		if (!representative.is_zero ())
 		{
 			// Move existing representation
-			ledger.store.representation_add (transaction, representative, balance);
+			ledger.representation_add (transaction, representative, balance);
 		}
 
 		if (is_send)
 		{
 			mol::pending_key key (block_a.hashables.link, hash);
-			while (!ledger.store.pending_exists (transaction, key))
-			{
-				ledger.rollback (transaction, ledger.latest (transaction, block_a.hashables.link));
-			}
-			ledger.store.pending_del (transaction, key);
+			assert (ledger.store.pending_exists (transaction, key));
+			ledger.pending_del (transaction, key);
 			ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::send);
 		}
 		else if (!block_a.hashables.link.is_zero ())
 		{
 			mol::pending_info info (ledger.account (transaction, block_a.hashables.link), block_a.hashables.balance.number () - balance);
-			ledger.store.pending_put (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link), info);
+			ledger.pending_put (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link), info);
 			ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::receive);
 		}
 
@@ -154,15 +163,346 @@ public:
 			ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::open);
 		}
 		ledger.store.block_del (transaction, hash);
+		ledger.sideband_del (transaction, hash);
+		ledger.height_del (transaction, block_a.hashables.account, 0, info.block_count);
+	}
+	void astate_block (mol::astate_block const & block_a) override
+	{
+		auto hash (block_a.hash ());
+		mol::asset_account_key key (block_a.hashables.account, block_a.hashables.asset);
+		mol::asset_account_info info;
+		auto error (ledger.store.asset_account_get (transaction, key, info));
+		assert (!error);
+		assert (info.head == hash);
+		auto balance (block_a.hashables.balance.number ());
+		if (info.open_block != hash)
+		{
+			auto previous_balance (ledger.balance (transaction, block_a.hashables.previous));
+			if (balance < previous_balance)
+			{
+				mol::pending_key pending_key (block_a.hashables.link, hash);
+				assert (ledger.store.pending_exists (transaction, pending_key));
+				ledger.pending_del (transaction, pending_key, block_a.hashables.asset);
+				ledger.asset_supply_update (transaction, block_a.hashables.asset, balance, previous_balance, balance - previous_balance);
+				ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::send);
+			}
+			else
+			{
+				mol::pending_info pending (ledger.account (transaction, block_a.hashables.link), balance - previous_balance);
+				ledger.pending_put (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link), pending, block_a.hashables.asset);
+				ledger.asset_supply_update (transaction, block_a.hashables.asset, balance, previous_balance, balance - previous_balance);
+				ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::receive);
+			}
+			ledger.store.asset_account_put (transaction, key, mol::asset_account_info (block_a.hashables.previous, info.rep_block, info.open_block, previous_balance, mol::seconds_since_epoch (), info.block_count - 1));
+		}
+		else
+		{
+			// First block of the asset chain, an open receiving the asset or the block issuing it
+			ledger.store.asset_account_del (transaction, key);
+			if (asset_open (block_a))
+			{
+				mol::pending_info pending (ledger.account (transaction, block_a.hashables.link), balance);
+				ledger.pending_put (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link), pending, block_a.hashables.asset);
+				ledger.asset_supply_update (transaction, block_a.hashables.asset, balance, 0, balance);
+			}
+			else
+			{
+				ledger.store.asset_del (transaction, block_a.hashables.asset);
+				ledger.asset_supply_update (transaction, block_a.hashables.asset, balance, 0, 0);
+			}
+			ledger.stats.inc (mol::stat::type::rollback, mol::stat::detail::open);
+		}
+		ledger.store.block_del (transaction, hash);
+		ledger.sideband_del (transaction, hash);
+		ledger.height_del (transaction, block_a.hashables.account, block_a.hashables.asset, info.block_count);
+	}
+	// Whether the first block of an asset chain received the asset rather than issued it
+	bool asset_open (mol::astate_block const & block_a)
+	{
+		auto result (false);
+		mol::block_sideband sideband;
+		if (!ledger.sideband_get (transaction, block_a.hash (), sideband))
+		{
+			result = sideband.subtype == mol::block_subtype::open;
+		}
+		else if (!block_a.hashables.link.is_zero ())
+		{
+			auto source (ledger.store.block_get (transaction, block_a.hashables.link));
+			result = source != nullptr && source->type () == mol::block_type::astate && static_cast<mol::astate_block const &> (*source).hashables.asset == block_a.hashables.asset;
+		}
+		return result;
 	}
 	MDB_txn * transaction;
 	mol::ledger & ledger;
 };
 
+/**
+ * Orders the removal of a block together with every block depending on it.
+ * Blocks above the target in its chain are removed first, the block receiving a send is removed before the send and
+ * the asset chains of an account are removed before its native open block.
+ */
+class rollback_planner
+{
+public:
+	rollback_planner (mol::ledger & ledger_a, MDB_txn * transaction_a) :
+	ledger (ledger_a),
+	transaction (transaction_a)
+	{
+	}
+	void remove (mol::block_hash const & target_a)
+	{
+		if (planned.find (target_a) == planned.end ())
+		{
+			auto target (ledger.store.block_get (transaction, target_a));
+			assert (target != nullptr);
+			auto account (ledger.account (transaction, target_a));
+			auto asset (chain_asset (*target));
+			auto & chain_head (head (account, asset));
+			auto done (false);
+			while (!done)
+			{
+				auto hash (chain_head);
+				assert (!hash.is_zero ());
+				auto block (hash == target_a ? std::move (target) : ledger.store.block_get (transaction, hash));
+				assert (block != nullptr);
+				chain_head = chain_previous (*block, hash, account, asset);
+				planned.insert (hash);
+				received.insert (source (*block));
+				dependents (*block, hash, account, asset);
+				order.push_back (std::move (block));
+				done = hash == target_a;
+			}
+		}
+	}
+	mol::ledger & ledger;
+	MDB_txn * transaction;
+	// Blocks in the order they are undone
+	std::vector<std::unique_ptr<mol::block>> order;
+
+private:
+	static mol::asset chain_asset (mol::block const & block_a)
+	{
+		mol::asset result (0);
+		if (block_a.type () == mol::block_type::astate)
+		{
+			result = static_cast<mol::astate_block const &> (block_a).hashables.asset;
+		}
+		return result;
+	}
+	// Head of a chain as it will be once the blocks planned so far are removed
+	mol::block_hash & head (mol::account const & account_a, mol::asset const & asset_a)
+	{
+		auto & chains (heads[account_a]);
+		auto existing (chains.find (asset_a));
+		if (existing == chains.end ())
+		{
+			mol::block_hash head_l (0);
+			if (asset_a.is_zero ())
+			{
+				mol::account_info info;
+				if (!ledger.store.account_get (transaction, account_a, info))
+				{
+					head_l = info.head;
+				}
+			}
+			else
+			{
+				mol::asset_account_info info;
+				if (!ledger.store.asset_account_get (transaction, mol::asset_account_key (account_a, asset_a), info))
+				{
+					head_l = info.head;
+				}
+			}
+			existing = chains.insert (std::make_pair (asset_a, head_l)).first;
+		}
+		return existing->second;
+	}
+	// Asset chains start on a native block, their first block ends the chain
+	mol::block_hash chain_previous (mol::block const & block_a, mol::block_hash const & hash_a, mol::account const & account_a, mol::asset const & asset_a)
+	{
+		mol::block_hash result (block_a.previous ());
+		if (!asset_a.is_zero ())
+		{
+			mol::asset_account_info info;
+			auto error (ledger.store.asset_account_get (transaction, mol::asset_account_key (account_a, asset_a), info));
+			assert (!error);
+			if (info.open_block == hash_a)
+			{
+				result.clear ();
+			}
+		}
+		return result;
+	}
+	void dependents (mol::block const & block_a, mol::block_hash const & hash_a, mol::account const & account_a, mol::asset const & asset_a)
+	{
+		mol::account destination (0);
+		switch (block_a.type ())
+		{
+			case mol::block_type::send:
+				destination = static_cast<mol::send_block const &> (block_a).hashables.destination;
+				break;
+			case mol::block_type::state:
+				destination = ledger.block_destination (transaction, block_a);
+				break;
+			case mol::block_type::astate:
+			{
+				auto const & astate (static_cast<mol::astate_block const &> (block_a));
+				mol::block_sideband sideband;
+				auto is_send (false);
+				if (!ledger.sideband_get (transaction, hash_a, sideband))
+				{
+					is_send = sideband.subtype == mol::block_subtype::send;
+				}
+				else
+				{
+					// The first block of an asset chain never sends, its previous is a native block
+					is_send = chain_previous (block_a, hash_a, account_a, asset_a) == block_a.previous () && astate.hashables.balance.number () < ledger.balance (transaction, block_a.previous ());
+				}
+				if (is_send)
+				{
+					destination = astate.hashables.link;
+				}
+				break;
+			}
+			default:
+				break;
+		}
+		if (!destination.is_zero () && received.find (hash_a) == received.end () && !ledger.store.pending_exists (transaction, mol::pending_key (destination, hash_a)))
+		{
+			// Already received and the receiving block isn't planned yet, it goes first
+			auto receiver_l (receiver (destination, asset_a, hash_a));
+			if (!receiver_l.is_zero ())
+			{
+				remove (receiver_l);
+			}
+		}
+		if (asset_a.is_zero () && block_a.previous ().is_zero ())
+		{
+			// Native open block, the account's asset chains start on it
+			for (auto & asset : assets (hash_a, account_a))
+			{
+				mol::asset_account_info info;
+				if (!ledger.store.asset_account_get (transaction, mol::asset_account_key (account_a, asset), info))
+				{
+					remove (info.open_block);
+				}
+			}
+		}
+	}
+	// Hash a block names as its source, state blocks name it in link
+	static mol::block_hash source (mol::block const & block_a)
+	{
+		mol::block_hash result;
+		switch (block_a.type ())
+		{
+			case mol::block_type::state:
+				result = static_cast<mol::state_block const &> (block_a).hashables.link;
+				break;
+			case mol::block_type::astate:
+				result = static_cast<mol::astate_block const &> (block_a).hashables.link;
+				break;
+			default:
+				result = block_a.source ();
+				break;
+		}
+		return result;
+	}
+	// Block in the destination chain that received source_a, searched from the chain's planned head down to its first block.
+	// Zero if the chain no longer holds it.
+	mol::block_hash receiver (mol::account const & account_a, mol::asset const & asset_a, mol::block_hash const & source_a)
+	{
+		mol::block_hash result (head (account_a, asset_a));
+		auto found (false);
+		while (!found && !result.is_zero ())
+		{
+			auto block (ledger.store.block_get (transaction, result));
+			assert (block != nullptr);
+			found = source (*block) == source_a;
+			if (!found)
+			{
+				result = chain_previous (*block, result, account_a, asset_a);
+			}
+		}
+		return result;
+	}
+	// Assets whose chains start on the native open block open_a. Chains opened before the height index existed aren't in it,
+	// an open block without a sideband predates the index so the account's asset accounts are read instead.
+	std::vector<mol::asset> assets (mol::block_hash const & open_a, mol::account const & account_a)
+	{
+		std::vector<mol::asset> result;
+		mol::block_sideband sideband;
+		if (!ledger.sideband_get (transaction, open_a, sideband))
+		{
+			result = ledger.account_assets (transaction, account_a);
+		}
+		else
+		{
+			// Asset accounts are keyed by account first, so the account's entries are contiguous
+			auto more (true);
+			for (auto i (ledger.store.asset_account_begin (transaction, mol::asset_account_key (account_a, 0))), n (ledger.store.asset_account_end ()); more && i != n; ++i)
+			{
+				mol::asset_account_key key (i->first);
+				more = key.account == account_a;
+				if (more)
+				{
+					result.push_back (key.asset);
+				}
+			}
+		}
+		return result;
+	}
+	std::unordered_set<mol::block_hash> planned;
+	// Sources of the planned blocks, a send whose receiving block is already planned needs nothing more
+	std::unordered_set<mol::block_hash> received;
+	std::unordered_map<mol::account, std::unordered_map<mol::asset, mol::block_hash>> heads;
+};
+
+/**
+ * Attributes the time between steps of astate processing to the step in progress
+ */
+class astate_stopwatch
+{
+public:
+	astate_stopwatch (mol::astate_timing & timing_a) :
+	timing (timing_a),
+	current (mol::astate_timing::step::lookup),
+	running (false)
+	{
+	}
+	~astate_stopwatch ()
+	{
+		stop ();
+	}
+	// End the current step and start step_a
+	void step (mol::astate_timing::step step_a)
+	{
+		auto now (std::chrono::steady_clock::now ());
+		if (running)
+		{
+			timing.add (current, now - start);
+		}
+		current = step_a;
+		start = now;
+		running = true;
+	}
+	void stop ()
+	{
+		if (running)
+		{
+			timing.add (current, std::chrono::steady_clock::now () - start);
+			running = false;
+		}
+	}
+	mol::astate_timing & timing;
+	mol::astate_timing::step current;
+	std::chrono::steady_clock::time_point start;
+	bool running;
+};
+
 class ledger_processor : public mol::block_visitor
 {
 public:
-	ledger_processor (mol::ledger &, MDB_txn *);
+	ledger_processor (mol::ledger &, MDB_txn *, std::map<mol::stat::detail, uint64_t> * = nullptr, std::unordered_map<mol::block_hash, bool> * = nullptr);
 	virtual ~ledger_processor () = default;
 	void send_block (mol::send_block const &) override;
 	void receive_block (mol::receive_block const &) override;
@@ -171,9 +511,17 @@ public:
 	void astate_block (mol::astate_block const &) override;
 	void state_block (mol::state_block const &) override;
 	void state_block_impl (mol::state_block const &);
+	mol::process_result source_pending (mol::account const &, mol::block_hash const &, mol::pending_info &);
+	bool signature_invalid (mol::block const &, mol::account const &, mol::block_hash const &);
+	void stat (mol::stat::detail);
+	bool block_exists (mol::block_hash const &);
 	mol::ledger & ledger;
 	MDB_txn * transaction;
 	mol::process_return result;
+	// When set, ledger stats are tallied here and recorded by the caller once per batch
+	std::map<mol::stat::detail, uint64_t> * batch_stats;
+	// When set, block existence already looked up for the batch, kept current by the caller as blocks are added
+	std::unordered_map<mol::block_hash, bool> * existing_blocks;
 };
 
 void ledger_processor::state_block (mol::state_block const & block_a)
@@ -188,11 +536,11 @@ void ledger_processor::state_block (mol::state_block const & block_a)
 void ledger_processor::state_block_impl (mol::state_block const & block_a)
 {
 	auto hash (block_a.hash ());
-	auto existing (ledger.store.block_exists (transaction, hash));
+	auto existing (block_exists (hash));
 	result.code = existing ? mol::process_result::old : mol::process_result::progress; // Have we seen this block before? (Unambiguous)
 	if (result.code == mol::process_result::progress)
 	{
-		result.code = validate_message (block_a.hashables.account, hash, block_a.signature) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Unambiguous)
+		result.code = signature_invalid (block_a, block_a.hashables.account, hash) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Unambiguous)
 		if (result.code == mol::process_result::progress)
 		{
 			result.code = block_a.hashables.account.is_zero () ? mol::process_result::opened_burn_account : mol::process_result::progress; // Is this for the burn account? (Unambiguous)
@@ -208,7 +556,7 @@ void ledger_processor::state_block_impl (mol::state_block const & block_a)
 					result.code = block_a.hashables.previous.is_zero () ? mol::process_result::fork : mol::process_result::progress; // Has this account already been opened? (Ambigious)
 					if (result.code == mol::process_result::progress)
 					{
-						result.code = ledger.store.block_exists (transaction, block_a.hashables.previous) ? mol::process_result::progress : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
+						result.code = block_exists (block_a.hashables.previous) ? mol::process_result::progress : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
 						if (result.code == mol::process_result::progress)
 						{
 							is_send = block_a.hashables.balance < info.balance;
@@ -223,7 +571,7 @@ void ledger_processor::state_block_impl (mol::state_block const & block_a)
 					result.code = block_a.previous ().is_zero () ? mol::process_result::progress : mol::process_result::gap_previous; // Does the first block in an account yield 0 for previous() ? (Unambigious)
 					if (result.code == mol::process_result::progress)
 					{
-						ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::open);
+						stat (mol::stat::detail::open);
 						result.code = !block_a.hashables.link.is_zero () ? mol::process_result::progress : mol::process_result::gap_source; // Is the first block receiving from a send ? (Unambigious)
 					}
 				}
@@ -233,7 +581,7 @@ void ledger_processor::state_block_impl (mol::state_block const & block_a)
 					{
 						if (!block_a.hashables.link.is_zero ())
 						{
-							result.code = ledger.store.block_exists (transaction, block_a.hashables.link) ? mol::process_result::progress : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
+							result.code = block_exists (block_a.hashables.link) ? mol::process_result::progress : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
 							if (result.code == mol::process_result::progress)
 							{
 								mol::pending_key key (block_a.hashables.account, block_a.hashables.link);
@@ -254,29 +602,32 @@ void ledger_processor::state_block_impl (mol::state_block const & block_a)
 				}
 				if (result.code == mol::process_result::progress)
 				{
-					ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::state_block);
+					stat (mol::stat::detail::state_block);
 					result.state_is_send = is_send;
 					ledger.store.block_put (transaction, hash, block_a);
+					auto subtype (is_send ? mol::block_subtype::send : block_a.hashables.link.is_zero () ? mol::block_subtype::change : block_a.hashables.previous.is_zero () ? mol::block_subtype::open : mol::block_subtype::receive);
+					ledger.sideband_put (transaction, hash, mol::block_sideband (info.block_count + 1, block_a.hashables.account, block_a.hashables.balance, subtype, mol::seconds_since_epoch ()));
+					ledger.height_put (transaction, block_a.hashables.account, 0, info.block_count + 1, hash);
 
 					if (!info.rep_block.is_zero ())
 					{
 						// Move existing representation
-						ledger.store.representation_add (transaction, info.rep_block, 0 - info.balance.number ());
+						ledger.representation_add (transaction, info.rep_block, 0 - info.balance.number ());
 					}
 					// Add in amount delta
-					ledger.store.representation_add (transaction, hash, block_a.hashables.balance.number ());
+					ledger.representation_add (transaction, hash, block_a.hashables.balance.number ());
 
 					if (is_send)
 					{
 						mol::pending_key key (block_a.hashables.link, hash);
 						mol::pending_info info (block_a.hashables.account, result.amount.number ());
-						ledger.store.pending_put (transaction, key, info);
-						ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::send);
+						ledger.pending_put (transaction, key, info);
+						stat (mol::stat::detail::send);
 					}
 					else if (!block_a.hashables.link.is_zero ())
 					{
-						ledger.store.pending_del (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link));
-						ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::receive);
+						ledger.pending_del (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link));
+						stat (mol::stat::detail::receive);
 					}
 
 					ledger.change_latest (transaction, block_a.hashables.account, hash, hash, block_a.hashables.balance, info.block_count + 1, true);
@@ -295,175 +646,140 @@ void ledger_processor::state_block_impl (mol::state_block const & block_a)
 //added by sandy - s
 void ledger_processor::astate_block (mol::astate_block const & block_a) {
 
+	astate_stopwatch stopwatch (ledger.astate_timing);
 	auto hash (block_a.hash ());
 	//ledger里是否存在block_a
-	auto existing (ledger.store.block_exists (transaction, hash));
+	auto existing (block_exists (hash));
 	result.code = existing ? mol::process_result::old : mol::process_result::progress; // Have we seen this block before? (Unambiguous)
 	if (result.code == mol::process_result::progress) {
 
 		//validate signature
-		result.code = validate_message (block_a.hashables.account, hash, block_a.signature) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Unambiguous)
+		stopwatch.step (mol::astate_timing::step::signature);
+		result.code = signature_invalid (block_a, block_a.hashables.account, hash) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Unambiguous)
 		if (result.code == mol::process_result::progress) {
 
 			//是否是销毁account
 			result.code = block_a.hashables.account.is_zero () ? mol::process_result::opened_burn_account : mol::process_result::progress; // Is this for the burn account? (Unambiguous)
 			if (result.code == mol::process_result::progress) {
 
-				//ledger里是否存在account
-				auto existing (ledger.store.account_exists(transaction, block_a.hashables.account));
-				result.code = existing ? mol::process_result::progress : mol::process_result::account_not_exist;
+				//一次查出account, asset和asset_account
+				stopwatch.step (mol::astate_timing::step::lookup);
+				auto state (ledger.asset_account_state (transaction, block_a.hashables.account, block_a.hashables.asset));
+				auto & info (state.account_info);
+				auto & info_asset_account (state.asset_account_info);
+				result.code = state.account_exists ? mol::process_result::progress : mol::process_result::account_not_exist;
 				if (result.code == mol::process_result::progress) {
 
-					//获取ledger account_info
-					mol::account_info info;
 					result.amount = block_a.hashables.balance;
 					auto is_send (false);
-					auto account_error (ledger.store.account_get (transaction, block_a.hashables.account, info));
-					if (!account_error) {
+					result.code = state.asset_exists ? mol::process_result::progress : mol::process_result::asset_not_exist;
+					if (result.code == mol::process_result::progress) {
 
-						//ledger里是否存在这个asset
-						auto existing (ledger.store.asset_exists(transaction, block_a.hashables.asset));
-						result.code = existing ? mol::process_result::progress : mol::process_result::asset_not_exist;
+						result.code = state.asset_account_exists ? mol::process_result::progress : mol::process_result::account_asset_not_exist;
 						if (result.code == mol::process_result::progress) {
 
-							//account对应的asset是否存在
-							auto existing (ledger.store.asset_account_exists(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset)));
-							result.code = existing ? mol::process_result::progress : mol::process_result::account_asset_not_exist;
-							if (result.code == mol::process_result::progress) {
+							// astete send / receive block
 
-								// astete send / receive block
+							// 如果block_a previous为zero, block_a错误
+							stopwatch.step (mol::astate_timing::step::previous);
+							result.code = block_a.hashables.previous.is_zero () ? mol::process_result::block_previous_error : mol::process_result::progress; // Has this account already been opened? (Ambigious)
+							if (result.code == mol::process_result::progress) {
 
-								// 如果block_a previous为zero, block_a错误
-								result.code = block_a.hashables.previous.is_zero () ? mol::process_result::block_previous_error : mol::process_result::progress; // Has this account already been opened? (Ambigious)
+								//previous是head block就一定存在, 否则才需要区分gap_previous
+								if (block_a.hashables.previous != info_asset_account.head) {
+									result.code = block_exists (block_a.hashables.previous) ? mol::process_result::block_previous_error : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
+								}
 								if (result.code == mol::process_result::progress) {
 
-									//如果block_a previous不存在,  则设置为mol::process_result::gap_previous
-									result.code = ledger.store.block_exists(transaction, block_a.hashables.previous)
-												  ? mol::process_result::progress
-												  : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
-									if (result.code == mol::process_result::progress) {
-
-										//mol::block_hash asset_account_head = ledger.asset_account_latest(transaction, block_a.hashables.account, block_a.hashables.asset);
-										//block previous 是否是 head block
-										//result.code = block_a.hashables.previous == asset_account_head ? mol::process_result::progress : mol::process_result::block_previous_error;
-
-										mol::asset_account_info info_asset_account;
-										auto latest_error(ledger.store.asset_account_get(transaction,
-																						 mol::asset_account_key(
-																								 block_a.hashables.account,
-																								 block_a.hashables.asset),
-																						 info_asset_account));
-										if (!latest_error) {
-
-											//block previous 是否是 head block
-											result.code = block_a.hashables.previous == info_asset_account.head ? mol::process_result::progress : mol::process_result::block_previous_error;
-											if (result.code == mol::process_result::progress) {
-
-												//如果新block余额 < 存在余额info.balance, 就是send block
-												is_send = block_a.hashables.balance < info_asset_account.balance;
-												result.amount = is_send ? (info_asset_account.balance.number () - result.amount.number ()) : (result.amount.number () - info_asset_account.balance.number ());
-
-												if (is_send) { // send block
+									//如果新block余额 < 存在余额info.balance, 就是send block
+									is_send = block_a.hashables.balance < info_asset_account.balance;
+									result.amount = is_send ? (info_asset_account.balance.number () - result.amount.number ()) : (result.amount.number () - info_asset_account.balance.number ());
 
-													//把block加到store
-													ledger.store.block_put (transaction, hash, block_a);
-													ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info_asset_account.rep_block, info_asset_account.open_block, block_a.hashables.balance, mol::seconds_since_epoch (), info_asset_account.block_count + 1));
+									if (is_send) { // send block
 
-													//如果是发送块, 设置pending表, 等待接收块
-													mol::pending_key key (block_a.hashables.link, hash);
-													mol::pending_info info (block_a.hashables.account, result.amount.number ());
-													ledger.store.pending_put (transaction, key, info);
+										//把block加到store
+										stopwatch.step (mol::astate_timing::step::write);
+										ledger.store.block_put (transaction, hash, block_a);
+										ledger.sideband_put (transaction, hash, mol::block_sideband (info_asset_account.block_count + 1, block_a.hashables.account, block_a.hashables.balance, mol::block_subtype::send, mol::seconds_since_epoch ()));
+										ledger.height_put (transaction, block_a.hashables.account, block_a.hashables.asset, info_asset_account.block_count + 1, hash);
+										ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info_asset_account.rep_block, info_asset_account.open_block, block_a.hashables.balance, mol::seconds_since_epoch (), info_asset_account.block_count + 1));
 
-												} else if (!block_a.hashables.link.is_zero ()) { // receive block
+										//如果是发送块, 设置pending表, 等待接收块
+										mol::pending_key key (block_a.hashables.link, hash);
+										mol::pending_info info (block_a.hashables.account, result.amount.number ());
+										ledger.pending_put (transaction, key, info, block_a.hashables.asset);
+										ledger.asset_supply_update (transaction, block_a.hashables.asset, info_asset_account.balance.number (), block_a.hashables.balance.number (), result.amount.number ());
 
-													//如果link对应的block不存在, 则mol::process_result::gap_source
-													result.code = ledger.store.block_exists (transaction, block_a.hashables.link) ? mol::process_result::progress : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
-													if (result.code == mol::process_result::progress) {
+									} else if (!block_a.hashables.link.is_zero ()) { // receive block
 
-														mol::pending_key key (block_a.hashables.account, block_a.hashables.link);
-														mol::pending_info pending;
-														//如果在pending表找不到pending_info, 则mol::process_result::unreceivable
-														result.code = ledger.store.pending_get (transaction, key, pending) ? mol::process_result::unreceivable : mol::process_result::progress; // Has this source already been received (Malformed)
-														if (result.code == mol::process_result::progress) {
-
-															//如果接收费用不一致, 则mol::process_result::balance_mismatch
-															result.code = result.amount == pending.amount ? mol::process_result::progress : mol::process_result::balance_mismatch;
-
-															if (result.code == mol::process_result::progress) {
-
-																//把block加到store
-																ledger.store.block_put (transaction, hash, block_a);
-																ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info_asset_account.rep_block, info_asset_account.open_block, block_a.hashables.balance, mol::seconds_since_epoch (), info_asset_account.block_count + 1));
-
-																//删除pending表的对应数据
-																ledger.store.pending_del (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link));
-															}
-
-														}
+										stopwatch.step (mol::astate_timing::step::source);
+										mol::pending_info pending;
+										result.code = source_pending (block_a.hashables.account, block_a.hashables.link, pending);
+										if (result.code == mol::process_result::progress) {
 
-													}
+											//如果接收费用不一致, 则mol::process_result::balance_mismatch
+											result.code = result.amount == pending.amount ? mol::process_result::progress : mol::process_result::balance_mismatch;
 
+											if (result.code == mol::process_result::progress) {
 
-												}
+												//把block加到store
+												stopwatch.step (mol::astate_timing::step::write);
+												ledger.store.block_put (transaction, hash, block_a);
+												ledger.sideband_put (transaction, hash, mol::block_sideband (info_asset_account.block_count + 1, block_a.hashables.account, block_a.hashables.balance, mol::block_subtype::receive, mol::seconds_since_epoch ()));
+												ledger.height_put (transaction, block_a.hashables.account, block_a.hashables.asset, info_asset_account.block_count + 1, hash);
+												ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info_asset_account.rep_block, info_asset_account.open_block, block_a.hashables.balance, mol::seconds_since_epoch (), info_asset_account.block_count + 1));
 
+												//删除pending表的对应数据
+												ledger.pending_del (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link), block_a.hashables.asset);
+												ledger.asset_supply_update (transaction, block_a.hashables.asset, info_asset_account.balance.number (), block_a.hashables.balance.number (), 0 - result.amount.number ());
 											}
+
 										}
 
 									}
 
 								}
 
+							}
 
+						} else if (result.code == mol::process_result::account_asset_not_exist) {
 
-							} else if (result.code == mol::process_result::account_asset_not_exist) {
+							// astate open block
 
-								// astate open block
+							// 如果block_a previous为zero, block_a错误
+							stopwatch.step (mol::astate_timing::step::previous);
+							result.code = block_a.hashables.previous.is_zero () ? mol::process_result::block_previous_error : mol::process_result::progress; // Has this account already been opened? (Ambigious)
+							if (result.code == mol::process_result::progress) {
 
-								// 如果block_a previous为zero, block_a错误
-								result.code = block_a.hashables.previous.is_zero () ? mol::process_result::block_previous_error : mol::process_result::progress; // Has this account already been opened? (Ambigious)
+								//block previous 是否是 开头block, 开头block一定存在
+								if (block_a.hashables.previous != info.open_block) {
+									result.code = block_exists (block_a.hashables.previous) ? mol::process_result::block_previous_error : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
+								}
 								if (result.code == mol::process_result::progress) {
 
-									//如果block_a previous不存在,  则设置为mol::process_result::gap_previous
-									result.code = ledger.store.block_exists(transaction, block_a.hashables.previous)
-												  ? mol::process_result::progress
-												  : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
-									if (result.code == mol::process_result::progress) {
-
-										//block previous 是否是 开头block
-										result.code = block_a.hashables.previous == info.open_block ? mol::process_result::progress : mol::process_result::block_previous_error;
+									//block link 是否是 zero
+									if (!block_a.hashables.link.is_zero ()) {
 
+										stopwatch.step (mol::astate_timing::step::source);
+										mol::pending_info pending;
+										result.code = source_pending (block_a.hashables.account, block_a.hashables.link, pending);
 										if (result.code == mol::process_result::progress) {
 
-											//block link 是否是 zero
-											if (!block_a.hashables.link.is_zero ()) {
-
-												//如果link对应的block不存在, 则mol::process_result::gap_source
-												result.code = ledger.store.block_exists (transaction, block_a.hashables.link) ? mol::process_result::progress : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
-												if (result.code == mol::process_result::progress) {
-
-													mol::pending_key key (block_a.hashables.account, block_a.hashables.link);
-													mol::pending_info pending;
-													//如果在pending表找不到pending_info, 则mol::process_result::unreceivable
-													result.code = ledger.store.pending_get (transaction, key, pending) ? mol::process_result::unreceivable : mol::process_result::progress; // Has this source already been received (Malformed)
-													if (result.code == mol::process_result::progress) {
+											//如果接收费用不一致, 则mol::process_result::balance_mismatch
+											result.code = result.amount == pending.amount ? mol::process_result::progress : mol::process_result::balance_mismatch;
 
-														//如果接收费用不一致, 则mol::process_result::balance_mismatch
-														result.code = result.amount == pending.amount ? mol::process_result::progress : mol::process_result::balance_mismatch;
-
-														if (result.code == mol::process_result::progress) {
-
-															//把block加到store
-															ledger.store.block_put (transaction, hash, block_a);
-															ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info.rep_block, hash, block_a.hashables.balance, mol::seconds_since_epoch (), 1));
-
-															//删除pending表的对应数据
-															ledger.store.pending_del (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link));
-
-														}
+											if (result.code == mol::process_result::progress) {
 
-													}
+												//把block加到store
+												stopwatch.step (mol::astate_timing::step::write);
+												ledger.store.block_put (transaction, hash, block_a);
+												ledger.sideband_put (transaction, hash, mol::block_sideband (1, block_a.hashables.account, block_a.hashables.balance, mol::block_subtype::open, mol::seconds_since_epoch ()));
+												ledger.height_put (transaction, block_a.hashables.account, block_a.hashables.asset, 1, hash);
+												ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info.rep_block, hash, block_a.hashables.balance, mol::seconds_since_epoch (), 1));
 
-												}
+												//删除pending表的对应数据
+												ledger.pending_del (transaction, mol::pending_key (block_a.hashables.account, block_a.hashables.link), block_a.hashables.asset);
+												ledger.asset_supply_update (transaction, block_a.hashables.asset, 0, block_a.hashables.balance.number (), 0 - result.amount.number ());
 
 											}
 
@@ -475,27 +791,31 @@ void ledger_processor::astate_block (mol::astate_block const & block_a) {
 
 							}
 
+						}
 
-						} else if (result.code == mol::process_result::asset_not_exist) {
-
-							//创建一个新asset
+					} else if (result.code == mol::process_result::asset_not_exist) {
 
-							// 如果block_a previous为zero, block_a错误
-							result.code = block_a.hashables.previous.is_zero () ? mol::process_result::block_previous_error : mol::process_result::progress; // Has this account already been opened? (Ambigious)
-							if (result.code == mol::process_result::progress) {
+						//创建一个新asset
 
-								//如果block_a previous不存在,  则设置为mol::process_result::gap_previous
-								result.code = ledger.store.block_exists(transaction, block_a.hashables.previous)
-											  ? mol::process_result::progress
-											  : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
-								if (result.code == mol::process_result::progress) {
+						// 如果block_a previous为zero, block_a错误
+						stopwatch.step (mol::astate_timing::step::previous);
+						result.code = block_a.hashables.previous.is_zero () ? mol::process_result::block_previous_error : mol::process_result::progress; // Has this account already been opened? (Ambigious)
+						if (result.code == mol::process_result::progress) {
 
-									//把block加到store
-									ledger.store.block_put (transaction, hash, block_a);
-									ledger.store.asset_put(transaction, block_a.hashables.asset, block_a.hashables.account);
-									ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info.rep_block, hash, block_a.hashables.balance, mol::seconds_since_epoch (), 1));
+							//如果block_a previous不存在,  则设置为mol::process_result::gap_previous
+							result.code = block_exists (block_a.hashables.previous)
+										  ? mol::process_result::progress
+										  : mol::process_result::gap_previous; // Does the previous block exist in the ledger? (Unambigious)
+							if (result.code == mol::process_result::progress) {
 
-								}
+								//把block加到store
+								stopwatch.step (mol::astate_timing::step::write);
+								ledger.store.block_put (transaction, hash, block_a);
+								ledger.sideband_put (transaction, hash, mol::block_sideband (1, block_a.hashables.account, block_a.hashables.balance, mol::block_subtype::issue, mol::seconds_since_epoch ()));
+								ledger.height_put (transaction, block_a.hashables.account, block_a.hashables.asset, 1, hash);
+								ledger.store.asset_put(transaction, block_a.hashables.asset, block_a.hashables.account);
+								ledger.store.asset_account_put(transaction, mol::asset_account_key(block_a.hashables.account, block_a.hashables.asset), mol::asset_account_info(hash, info.rep_block, hash, block_a.hashables.balance, mol::seconds_since_epoch (), 1));
+								ledger.asset_supply_update (transaction, block_a.hashables.asset, 0, block_a.hashables.balance.number (), 0);
 
 							}
 
@@ -505,7 +825,6 @@ void ledger_processor::astate_block (mol::astate_block const & block_a) {
 
 				}
 
-
 			}
 
 		}
@@ -513,12 +832,24 @@ void ledger_processor::astate_block (mol::astate_block const & block_a) {
 	}
 
 }
+
+// Pending entry for an asset receive, the source block is only looked up to tell a gap from an entry that was already received
+mol::process_result ledger_processor::source_pending (mol::account const & account_a, mol::block_hash const & source_a, mol::pending_info & pending_a)
+{
+	auto result (mol::process_result::progress);
+	//在pending表找到pending_info, source block就一定存在
+	if (ledger.store.pending_get (transaction, mol::pending_key (account_a, source_a), pending_a)) {
+		//如果link对应的block不存在, 则mol::process_result::gap_source, 否则mol::process_result::unreceivable
+		result = block_exists (source_a) ? mol::process_result::unreceivable : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
+	}
+	return result;
+}
 //added by sandy - e
 
 void ledger_processor::change_block (mol::change_block const & block_a)
 {
 	auto hash (block_a.hash ());
-	auto existing (ledger.store.block_exists (transaction, hash));
+	auto existing (block_exists (hash));
 	result.code = existing ? mol::process_result::old : mol::process_result::progress; // Have we seen this block before? (Harmless)
 	if (result.code == mol::process_result::progress)
 	{
@@ -537,19 +868,21 @@ void ledger_processor::change_block (mol::change_block const & block_a)
 					auto latest_error (ledger.store.account_get (transaction, account, info));
 					assert (!latest_error);
 					assert (info.head == block_a.hashables.previous);
-					result.code = validate_message (account, hash, block_a.signature) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Malformed)
+					result.code = signature_invalid (block_a, account, hash) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Malformed)
 					if (result.code == mol::process_result::progress)
 					{
 						ledger.store.block_put (transaction, hash, block_a);
+						ledger.sideband_put (transaction, hash, mol::block_sideband (info.block_count + 1, account, info.balance, mol::block_subtype::change, mol::seconds_since_epoch ()));
+						ledger.height_put (transaction, account, 0, info.block_count + 1, hash);
 						auto balance (ledger.balance (transaction, block_a.hashables.previous));
-						ledger.store.representation_add (transaction, hash, balance);
-						ledger.store.representation_add (transaction, info.rep_block, 0 - balance);
+						ledger.representation_add (transaction, hash, balance);
+						ledger.representation_add (transaction, info.rep_block, 0 - balance);
 						ledger.change_latest (transaction, account, hash, hash, info.balance, info.block_count + 1);
 						ledger.store.frontier_del (transaction, block_a.hashables.previous);
 						ledger.store.frontier_put (transaction, hash, account);
 						result.account = account;
 						result.amount = 0;
-						ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::change);
+						stat (mol::stat::detail::change);
 					}
 				}
 			}
@@ -560,7 +893,7 @@ void ledger_processor::change_block (mol::change_block const & block_a)
 void ledger_processor::send_block (mol::send_block const & block_a)
 {
 	auto hash (block_a.hash ());
-	auto existing (ledger.store.block_exists (transaction, hash));
+	auto existing (block_exists (hash));
 	result.code = existing ? mol::process_result::old : mol::process_result::progress; // Have we seen this block before? (Harmless)
 	if (result.code == mol::process_result::progress)
 	{
@@ -575,7 +908,7 @@ void ledger_processor::send_block (mol::send_block const & block_a)
 				result.code = account.is_zero () ? mol::process_result::fork : mol::process_result::progress;
 				if (result.code == mol::process_result::progress)
 				{
-					result.code = validate_message (account, hash, block_a.signature) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Malformed)
+					result.code = signature_invalid (block_a, account, hash) ? mol::process_result::bad_signature : mol::process_result::progress; // Is this block signed correctly (Malformed)
 					if (result.code == mol::process_result::progress)
 					{
 						mol::account_info info;
@@ -586,16 +919,18 @@ void ledger_processor::send_block (mol::send_block const & block_a)
 						if (result.code == mol::process_result::progress)
 						{
 							auto amount (info.balance.number () - block_a.hashables.balance.number ());
-							ledger.store.representation_add (transaction, info.rep_block, 0 - amount);
+							ledger.representation_add (transaction, info.rep_block, 0 - amount);
 							ledger.store.block_put (transaction, hash, block_a);
+							ledger.sideband_put (transaction, hash, mol::block_sideband (info.block_count + 1, account, block_a.hashables.balance, mol::block_subtype::send, mol::seconds_since_epoch ()));
+							ledger.height_put (transaction, account, 0, info.block_count + 1, hash);
 							ledger.change_latest (transaction, account, hash, info.rep_block, block_a.hashables.balance, info.block_count + 1);
-							ledger.store.pending_put (transaction, mol::pending_key (block_a.hashables.destination, hash), { account, amount });
+							ledger.pending_put (transaction, mol::pending_key (block_a.hashables.destination, hash), { account, amount });
 							ledger.store.frontier_del (transaction, block_a.hashables.previous);
 							ledger.store.frontier_put (transaction, hash, account);
 							result.account = account;
 							result.amount = amount;
 							result.pending_account = block_a.hashables.destination;
-							ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::send);
+							stat (mol::stat::detail::send);
 						}
 					}
 				}
@@ -607,7 +942,7 @@ void ledger_processor::send_block (mol::send_block const & block_a)
 void ledger_processor::receive_block (mol::receive_block const & block_a)
 {
 	auto hash (block_a.hash ());
-	auto existing (ledger.store.block_exists (transaction, hash));
+	auto existing (block_exists (hash));
 	result.code = existing ? mol::process_result::old : mol::process_result::progress; // Have we seen this block already?  (Harmless)
 	if (result.code == mol::process_result::progress)
 	{
@@ -618,14 +953,14 @@ void ledger_processor::receive_block (mol::receive_block const & block_a)
 			result.code = block_a.valid_predecessor (*previous) ? mol::process_result::progress : mol::process_result::block_position;
 			if (result.code == mol::process_result::progress)
 			{
-				result.code = ledger.store.block_exists (transaction, block_a.hashables.source) ? mol::process_result::progress : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
+				result.code = block_exists (block_a.hashables.source) ? mol::process_result::progress : mol::process_result::gap_source; // Have we seen the source block already? (Harmless)
 				if (result.code == mol::process_result::progress)
 				{
 					auto account (ledger.store.frontier_get (transaction, block_a.hashables.previous));
 					result.code = account.is_zero () ? mol::process_result::gap_previous : mol::process_result::progress; //Have we seen the previous block? No entries for account at all (Harmless)
 					if (result.code == mol::process_result::progress)
 					{
-						result.code = mol::validate_message (account, hash, block_a.signature) ? mol::process_result::bad_signature : mol::process_result::progress; // Is the signature valid (Malformed)
+						result.code = signature_invalid (block_a, account, hash) ? mol::process_result::bad_signature : mol::process_result::progress; // Is the signature valid (Malformed)
 						if (result.code == mol::process_result::progress)
 						{
 							mol::account_info info;
@@ -642,22 +977,24 @@ void ledger_processor::receive_block (mol::receive_block const & block_a)
 									mol::account_info source_info;
 									auto error (ledger.store.account_get (transaction, pending.source, source_info));
 									assert (!error);
-									ledger.store.pending_del (transaction, key);
+									ledger.pending_del (transaction, key);
 									ledger.store.block_put (transaction, hash, block_a);
+									ledger.sideband_put (transaction, hash, mol::block_sideband (info.block_count + 1, account, new_balance, mol::block_subtype::receive, mol::seconds_since_epoch ()));
+									ledger.height_put (transaction, account, 0, info.block_count + 1, hash);
 									ledger.change_latest (transaction, account, hash, info.rep_block, new_balance, info.block_count + 1);
-									ledger.store.representation_add (transaction, info.rep_block, pending.amount.number ());
+									ledger.representation_add (transaction, info.rep_block, pending.amount.number ());
 									ledger.store.frontier_del (transaction, block_a.hashables.previous);
 									ledger.store.frontier_put (transaction, hash, account);
 									result.account = account;
 									result.amount = pending.amount;
-									ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::receive);
+									stat (mol::stat::detail::receive);
 								}
 							}
 						}
 					}
 					else
 					{
-						result.code = ledger.store.block_exists (transaction, block_a.hashables.previous) ? mol::process_result::fork : mol::process_result::gap_previous; // If we have the block but it's not the latest we have a signed fork (Malicious)
+						result.code = block_exists (block_a.hashables.previous) ? mol::process_result::fork : mol::process_result::gap_previous; // If we have the block but it's not the latest we have a signed fork (Malicious)
 					}
 				}
 			}
@@ -668,15 +1005,15 @@ void ledger_processor::receive_block (mol::receive_block const & block_a)
 void ledger_processor::open_block (mol::open_block const & block_a)
 {
 	auto hash (block_a.hash ());
-	auto existing (ledger.store.block_exists (transaction, hash));
+	auto existing (block_exists (hash));
 	result.code = existing ? mol::process_result::old : mol::process_result::progress; // Have we seen this block already? (Harmless)
 	if (result.code == mol::process_result::progress)
 	{
-		auto source_missing (!ledger.store.block_exists (transaction, block_a.hashables.source));
+		auto source_missing (!block_exists (block_a.hashables.source));
 		result.code = source_missing ? mol::process_result::gap_source : mol::process_result::progress; // Have we seen the source block? (Harmless)
 		if (result.code == mol::process_result::progress)
 		{
-			result.code = mol::validate_message (block_a.hashables.account, hash, block_a.signature) ? mol::process_result::bad_signature : mol::process_result::progress; // Is the signature valid (Malformed)
+			result.code = signature_invalid (block_a, block_a.hashables.account, hash) ? mol::process_result::bad_signature : mol::process_result::progress; // Is the signature valid (Malformed)
 			if (result.code == mol::process_result::progress)
 			{
 				mol::account_info info;
@@ -694,14 +1031,16 @@ void ledger_processor::open_block (mol::open_block const & block_a)
 							mol::account_info source_info;
 							auto error (ledger.store.account_get (transaction, pending.source, source_info));
 							assert (!error);
-							ledger.store.pending_del (transaction, key);
+							ledger.pending_del (transaction, key);
 							ledger.store.block_put (transaction, hash, block_a);
+							ledger.sideband_put (transaction, hash, mol::block_sideband (1, block_a.hashables.account, pending.amount, mol::block_subtype::open, mol::seconds_since_epoch ()));
+							ledger.height_put (transaction, block_a.hashables.account, 0, 1, hash);
 							ledger.change_latest (transaction, block_a.hashables.account, hash, hash, pending.amount.number (), info.block_count + 1);
-							ledger.store.representation_add (transaction, hash, pending.amount.number ());
+							ledger.representation_add (transaction, hash, pending.amount.number ());
 							ledger.store.frontier_put (transaction, hash, block_a.hashables.account);
 							result.account = block_a.hashables.account;
 							result.amount = pending.amount;
-							ledger.stats.inc (mol::stat::type::ledger, mol::stat::detail::open);
+							stat (mol::stat::detail::open);
 						}
 					}
 				}
@@ -710,11 +1049,99 @@ void ledger_processor::open_block (mol::open_block const & block_a)
 	}
 }
 
-ledger_processor::ledger_processor (mol::ledger & ledger_a, MDB_txn * transaction_a) :
+// Signatures already checked by ledger::verify_signatures against the same account are trusted
+bool ledger_processor::signature_invalid (mol::block const & block_a, mol::account const & account_a, mol::block_hash const & hash_a)
+{
+	auto result (false);
+	if (!block_a.signature_verified (account_a))
+	{
+		result = mol::validate_message (account_a, hash_a, block_a.block_signature ());
+	}
+	return result;
+}
+
+ledger_processor::ledger_processor (mol::ledger & ledger_a, MDB_txn * transaction_a, std::map<mol::stat::detail, uint64_t> * batch_stats_a, std::unordered_map<mol::block_hash, bool> * existing_blocks_a) :
 ledger (ledger_a),
-transaction (transaction_a)
+transaction (transaction_a),
+batch_stats (batch_stats_a),
+existing_blocks (existing_blocks_a)
+{
+}
+
+void ledger_processor::stat (mol::stat::detail detail_a)
+{
+	if (batch_stats != nullptr)
+	{
+		++(*batch_stats)[detail_a];
+	}
+	else
+	{
+		ledger.stats.inc (mol::stat::type::ledger, detail_a);
+	}
+}
+
+bool ledger_processor::block_exists (mol::block_hash const & hash_a)
 {
+	auto result (false);
+	auto found (false);
+	if (existing_blocks != nullptr)
+	{
+		auto existing (existing_blocks->find (hash_a));
+		if (existing != existing_blocks->end ())
+		{
+			result = existing->second;
+			found = true;
+		}
+	}
+	if (!found)
+	{
+		result = ledger.store.block_exists (transaction, hash_a);
+	}
+	return result;
 }
+
+/**
+ * Key of the height index, heights are big endian so a chain is stored in height order
+ */
+class height_key
+{
+public:
+	height_key (mol::account const & account_a, mol::asset const & asset_a, uint64_t height_a)
+	{
+		std::copy (account_a.bytes.begin (), account_a.bytes.end (), bytes.begin ());
+		std::copy (asset_a.bytes.begin (), asset_a.bytes.end (), bytes.begin () + sizeof (mol::account));
+		for (auto i (bytes.rbegin ()), n (bytes.rbegin () + sizeof (uint64_t)); i != n; ++i)
+		{
+			*i = static_cast<uint8_t> (height_a);
+			height_a >>= 8;
+		}
+	}
+	mol::mdb_val val ()
+	{
+		return mol::mdb_val (bytes.size (), bytes.data ());
+	}
+	std::array<uint8_t, sizeof (mol::account) + sizeof (mol::asset) + sizeof (uint64_t)> bytes;
+};
+
+/**
+ * Key of the asset pending index, entries of one account and asset are adjacent
+ */
+class asset_pending_key
+{
+public:
+	asset_pending_key (mol::account const & account_a, mol::asset const & asset_a, mol::block_hash const & hash_a)
+	{
+		std::copy (account_a.bytes.begin (), account_a.bytes.end (), bytes.begin ());
+		std::copy (asset_a.bytes.begin (), asset_a.bytes.end (), bytes.begin () + sizeof (mol::account));
+		std::copy (hash_a.bytes.begin (), hash_a.bytes.end (), bytes.begin () + sizeof (mol::account) + sizeof (mol::asset));
+	}
+	mol::mdb_val val ()
+	{
+		return mol::mdb_val (bytes.size (), bytes.data ());
+	}
+	static size_t constexpr prefix_size = sizeof (mol::account) + sizeof (mol::asset);
+	std::array<uint8_t, prefix_size + sizeof (mol::block_hash)> bytes;
+};
 } // namespace
 
 size_t mol::shared_ptr_block_hash::operator() (std::shared_ptr<mol::block> const & block_a) const
@@ -730,55 +1157,105 @@ bool mol::shared_ptr_block_hash::operator() (std::shared_ptr<mol::block> const &
 }
 
 mol::ledger::ledger (mol::block_store & store_a, mol::stat & stat_a, mol::block_hash const & state_block_parse_canary_a, mol::block_hash const & state_block_generate_canary_a) :
+ledger (store_a, stat_a, mol::transaction (store_a.environment, nullptr, true), state_block_parse_canary_a, state_block_generate_canary_a)
+{
+}
+
+mol::ledger::ledger (mol::block_store & store_a, mol::stat & stat_a, MDB_txn * transaction_a, mol::block_hash const & state_block_parse_canary_a, mol::block_hash const & state_block_generate_canary_a) :
 store (store_a),
 stats (stat_a),
 check_bootstrap_weights (true),
 state_block_parse_canary (state_block_parse_canary_a),
-state_block_generate_canary (state_block_generate_canary_a)
+state_block_generate_canary (state_block_generate_canary_a),
+state_block_parse_canary_exists (false),
+state_block_generate_canary_exists (false),
+signature_checker (std::max (1u, std::thread::hardware_concurrency ())),
+state_loaded (false),
+changes_transaction (nullptr)
+{
+	auto status (mdb_dbi_open (transaction_a, "block_sideband", MDB_CREATE, &sidebands));
+	assert (status == 0);
+	status = mdb_dbi_open (transaction_a, "chain_height", MDB_CREATE, &heights);
+	assert (status == 0);
+	sidebands_build (transaction_a);
+	status = mdb_dbi_open (transaction_a, "pending_summary", MDB_CREATE, &pending_summaries);
+	assert (status == 0);
+	pending_summaries_build (transaction_a);
+	status = mdb_dbi_open (transaction_a, "asset_pending", 0, &asset_pendings);
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == MDB_NOTFOUND)
+	{
+		status = mdb_dbi_open (transaction_a, "asset_pending", MDB_CREATE, &asset_pendings);
+		assert (status == 0);
+		asset_pendings_build (transaction_a);
+	}
+	status = mdb_dbi_open (transaction_a, "asset_supply", 0, &asset_supplies);
+	assert (status == 0 || status == MDB_NOTFOUND);
+	if (status == MDB_NOTFOUND)
+	{
+		status = mdb_dbi_open (transaction_a, "asset_supply", MDB_CREATE, &asset_supplies);
+		assert (status == 0);
+		asset_supplies_build (transaction_a);
+	}
+}
+
+mol::ledger_transaction::ledger_transaction (mol::ledger & ledger_a) :
+ledger (ledger_a),
+transaction (new mol::transaction (ledger_a.store.environment, nullptr, true))
 {
+	handle = *transaction;
 }
 
-// Sum the weights for each vote and return the winning block with its vote tally
-std::pair<mol::uint128_t, std::shared_ptr<mol::block>> mol::ledger::winner (MDB_txn * transaction_a, mol::votes const & votes_a)
+mol::ledger_transaction::~ledger_transaction ()
 {
-	auto tally_l (tally (transaction_a, votes_a));
-	auto existing (tally_l.begin ());
-	return std::make_pair (existing->first, existing->second);
+	transaction.reset ();
+	ledger.committed (handle);
 }
 
-std::map<mol::uint128_t, std::shared_ptr<mol::block>, std::greater<mol::uint128_t>> mol::ledger::tally (MDB_txn * transaction_a, mol::votes const & votes_a)
+mol::ledger_transaction::operator MDB_txn * () const
 {
-	std::unordered_map<std::shared_ptr<block>, mol::uint128_t, mol::shared_ptr_block_hash, mol::shared_ptr_block_hash> totals;
-	// Construct a map of blocks -> vote total.
+	return handle;
+}
+
+// Sum the weights for each vote and return the winning block with its vote tally
+std::pair<mol::uint128_t, std::shared_ptr<mol::block>> mol::ledger::winner (MDB_txn * transaction_a, mol::votes const & votes_a)
+{
+	mol::vote_tally tally (*this);
 	for (auto & i : votes_a.rep_votes)
 	{
-		auto existing (totals.find (i.second));
-		if (existing == totals.end ())
-		{
-			totals.insert (std::make_pair (i.second, 0));
-			existing = totals.find (i.second);
-			assert (existing != totals.end ());
-		}
-		auto weight_l (weight (transaction_a, i.first));
-		existing->second += weight_l;
+		tally.vote (transaction_a, i.first, i.second);
 	}
-	// Construction a map of vote total -> block in decreasing order.
-	std::map<mol::uint128_t, std::shared_ptr<mol::block>, std::greater<mol::uint128_t>> result;
-	for (auto & i : totals)
+	return tally.winner ();
+}
+
+mol::tally_t mol::ledger::tally (MDB_txn * transaction_a, mol::votes const & votes_a)
+{
+	mol::vote_tally tally (*this);
+	for (auto & i : votes_a.rep_votes)
 	{
-		result[i.second] = i.first;
+		tally.vote (transaction_a, i.first, i.second);
 	}
-	return result;
+	return tally.tally ();
 }
 
 // Balance for account containing hash
 mol::uint128_t mol::ledger::balance (MDB_txn * transaction_a, mol::block_hash const & hash_a)
 {
-	balance_visitor visitor (transaction_a, store);
-	visitor.compute (hash_a);
-	return visitor.result;
-}
-
+	mol::uint128_t result;
+	mol::block_sideband sideband;
+	if (!hash_a.is_zero () && !sideband_get (transaction_a, hash_a, sideband))
+	{
+		result = sideband.balance.number ();
+	}
+	else
+	{
+		balance_visitor visitor (transaction_a, store);
+		visitor.compute (hash_a);
+		result = visitor.result;
+	}
+	return result;
+}
+
 // Balance for an account by account number
 mol::uint128_t mol::ledger::account_balance (MDB_txn * transaction_a, mol::account const & account_a)
 {
@@ -795,22 +1272,537 @@ mol::uint128_t mol::ledger::account_balance (MDB_txn * transaction_a, mol::accou
 mol::uint128_t mol::ledger::account_pending (MDB_txn * transaction_a, mol::account const & account_a)
 {
 	mol::uint128_t result (0);
-	mol::account end (account_a.number () + 1);
-	for (auto i (store.pending_begin (transaction_a, mol::pending_key (account_a, 0))), n (store.pending_begin (transaction_a, mol::pending_key (end, 0))); i != n; ++i)
+	mol::pending_summary summary;
+	if (!pending_summary_get (transaction_a, account_a, summary))
+	{
+		result = summary.total.number ();
+	}
+	return result;
+}
+
+bool mol::ledger::pending_summary_get (MDB_txn * transaction_a, mol::account const & account_a, mol::pending_summary & summary_a)
+{
+	mol::mdb_val value;
+	auto status (mdb_get (transaction_a, pending_summaries, mol::mdb_val (account_a), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	bool result (true);
+	if (status == 0)
+	{
+		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		result = summary_a.deserialize (stream);
+		assert (!result);
+	}
+	return result;
+}
+
+void mol::ledger::pending_summary_put (MDB_txn * transaction_a, mol::account const & account_a, mol::pending_summary const & summary_a)
+{
+	if (summary_a.count > 0)
+	{
+		std::vector<uint8_t> bytes;
+		{
+			mol::vectorstream stream (bytes);
+			summary_a.serialize (stream);
+		}
+		auto status (mdb_put (transaction_a, pending_summaries, mol::mdb_val (account_a), mol::mdb_val (bytes.size (), bytes.data ()), 0));
+		assert (status == 0);
+	}
+	else
+	{
+		auto status (mdb_del (transaction_a, pending_summaries, mol::mdb_val (account_a), nullptr));
+		assert (status == 0 || status == MDB_NOTFOUND);
+	}
+}
+
+// Deleting the last entry at the maximum leaves max as an upper bound instead of rescanning the account's pending entries, rescan here only when asked for the exact value
+mol::uint128_t mol::ledger::pending_max (MDB_txn * transaction_a, mol::account const & account_a)
+{
+	mol::uint128_t result (0);
+	mol::pending_summary summary;
+	if (!pending_summary_get (transaction_a, account_a, summary))
+	{
+		if (summary.max_count > 0)
+		{
+			result = summary.max.number ();
+		}
+		else
+		{
+			mol::account end (account_a.number () + 1);
+			for (auto i (store.pending_begin (transaction_a, mol::pending_key (account_a, 0))), n (store.pending_begin (transaction_a, mol::pending_key (end, 0))); i != n; ++i)
+			{
+				mol::pending_info info (i->second);
+				result = std::max (result, info.amount.number ());
+			}
+		}
+	}
+	return result;
+}
+
+void mol::ledger::pending_put (MDB_txn * transaction_a, mol::pending_key const & key_a, mol::pending_info const & info_a, mol::asset const & asset_a)
+{
+	if (!asset_a.is_zero ())
+	{
+		asset_pending_put (transaction_a, key_a, info_a, asset_a);
+	}
+	mol::pending_summary summary;
+	pending_summary_get (transaction_a, key_a.account, summary);
+	summary.add (info_a.amount.number ());
+	pending_summary_put (transaction_a, key_a.account, summary);
+	store.pending_put (transaction_a, key_a, info_a);
+}
+
+void mol::ledger::pending_del (MDB_txn * transaction_a, mol::pending_key const & key_a, mol::asset const & asset_a)
+{
+	if (!asset_a.is_zero ())
+	{
+		asset_pending_key key (key_a.account, asset_a, key_a.hash);
+		auto status (mdb_del (transaction_a, asset_pendings, key.val (), nullptr));
+		assert (status == 0 || status == MDB_NOTFOUND);
+	}
+	mol::pending_info info;
+	auto error (store.pending_get (transaction_a, key_a, info));
+	assert (!error);
+	store.pending_del (transaction_a, key_a);
+	mol::pending_summary summary;
+	error = pending_summary_get (transaction_a, key_a.account, summary);
+	assert (!error && summary.count > 0);
+	summary.remove (info.amount.number ());
+	pending_summary_put (transaction_a, key_a.account, summary);
+}
+
+void mol::ledger::asset_pending_for_each (MDB_txn * transaction_a, mol::account const & account_a, mol::asset const & asset_a, std::function<bool(mol::block_hash const &, mol::pending_info const &)> const & action_a)
+{
+	asset_pending_key start (account_a, asset_a, 0);
+	MDB_cursor * cursor;
+	auto status (mdb_cursor_open (transaction_a, asset_pendings, &cursor));
+	assert (status == 0);
+	mol::mdb_val key (start.val ());
+	mol::mdb_val value;
+	status = mdb_cursor_get (cursor, key, value, MDB_SET_RANGE);
+	auto more (true);
+	while (more && status == 0 && key.size () == start.bytes.size () && std::equal (start.bytes.begin (), start.bytes.begin () + asset_pending_key::prefix_size, reinterpret_cast<uint8_t const *> (key.data ())))
+	{
+		mol::block_hash hash;
+		std::copy_n (reinterpret_cast<uint8_t const *> (key.data ()) + asset_pending_key::prefix_size, hash.bytes.size (), hash.bytes.begin ());
+		mol::pending_info info;
+		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		auto error (info.deserialize (stream));
+		assert (!error);
+		more = action_a (hash, info);
+		status = mdb_cursor_get (cursor, key, value, MDB_NEXT);
+	}
+	assert (status == 0 || status == MDB_NOTFOUND);
+	mdb_cursor_close (cursor);
+}
+
+// Index the asset sends already pending when the asset pending table is first created
+void mol::ledger::asset_pendings_build (MDB_txn * transaction_a)
+{
+	for (auto i (store.pending_begin (transaction_a)), n (store.pending_end ()); i != n; ++i)
+	{
+		mol::pending_key key (i->first);
+		auto block (store.block_get (transaction_a, key.hash));
+		if (block != nullptr && block->type () == mol::block_type::astate)
+		{
+			asset_pending_put (transaction_a, key, mol::pending_info (i->second), static_cast<mol::astate_block const &> (*block).hashables.asset);
+		}
+	}
+}
+
+void mol::ledger::asset_pending_put (MDB_txn * transaction_a, mol::pending_key const & key_a, mol::pending_info const & info_a, mol::asset const & asset_a)
+{
+	std::vector<uint8_t> bytes;
+	{
+		mol::vectorstream stream (bytes);
+		info_a.serialize (stream);
+	}
+	asset_pending_key key (key_a.account, asset_a, key_a.hash);
+	auto status (mdb_put (transaction_a, asset_pendings, key.val (), mol::mdb_val (bytes.size (), bytes.data ()), 0));
+	assert (status == 0);
+}
+
+mol::asset_account_state mol::ledger::asset_account_state (MDB_txn * transaction_a, mol::account const & account_a, mol::asset const & asset_a)
+{
+	mol::asset_account_state result;
+	result.account_exists = !store.account_get (transaction_a, account_a, result.account_info);
+	if (result.account_exists)
+	{
+		result.asset_account_exists = !store.asset_account_get (transaction_a, mol::asset_account_key (account_a, asset_a), result.asset_account_info);
+		// An account can only hold an asset that exists
+		result.asset_exists = result.asset_account_exists || store.asset_exists (transaction_a, asset_a);
+	}
+	return result;
+}
+
+bool mol::ledger::asset_supply_get (MDB_txn * transaction_a, mol::asset const & asset_a, mol::asset_supply & supply_a)
+{
+	mol::mdb_val value;
+	auto status (mdb_get (transaction_a, asset_supplies, mol::mdb_val (asset_a), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	bool result (true);
+	if (status == 0)
 	{
-		mol::pending_info info (i->second);
-		result += info.amount.number ();
+		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		result = supply_a.deserialize (stream);
+		assert (!result);
 	}
 	return result;
 }
 
+void mol::ledger::asset_supply_put (MDB_txn * transaction_a, mol::asset const & asset_a, mol::asset_supply const & supply_a)
+{
+	std::vector<uint8_t> bytes;
+	{
+		mol::vectorstream stream (bytes);
+		supply_a.serialize (stream);
+	}
+	auto status (mdb_put (transaction_a, asset_supplies, mol::mdb_val (asset_a), mol::mdb_val (bytes.size (), bytes.data ()), 0));
+	assert (status == 0);
+}
+
+void mol::ledger::asset_supply_update (MDB_txn * transaction_a, mol::asset const & asset_a, mol::uint128_t const & old_balance_a, mol::uint128_t const & new_balance_a, mol::uint128_t const & pending_delta_a)
+{
+	mol::asset_supply supply;
+	asset_supply_get (transaction_a, asset_a, supply);
+	supply.total = supply.total.number () - old_balance_a + new_balance_a;
+	if (old_balance_a.is_zero () && !new_balance_a.is_zero ())
+	{
+		++supply.holders;
+	}
+	else if (!old_balance_a.is_zero () && new_balance_a.is_zero ())
+	{
+		assert (supply.holders > 0);
+		--supply.holders;
+	}
+	supply.pending = supply.pending.number () + pending_delta_a;
+	supply.modified = mol::seconds_since_epoch ();
+	asset_supply_put (transaction_a, asset_a, supply);
+}
+
+// Aggregate the asset accounts and pending asset sends present when the supply table is first created
+void mol::ledger::asset_supplies_build (MDB_txn * transaction_a)
+{
+	std::unordered_map<mol::asset, mol::asset_supply> supplies;
+	auto now (mol::seconds_since_epoch ());
+	for (auto i (store.asset_account_begin (transaction_a)), n (store.asset_account_end ()); i != n; ++i)
+	{
+		mol::asset_account_key key (i->first);
+		mol::asset_account_info info (i->second);
+		auto & supply (supplies[key.asset]);
+		supply.total = supply.total.number () + info.balance.number ();
+		supply.holders += info.balance.is_zero () ? 0 : 1;
+		supply.modified = now;
+	}
+	MDB_cursor * cursor;
+	auto status (mdb_cursor_open (transaction_a, asset_pendings, &cursor));
+	assert (status == 0);
+	mol::mdb_val key;
+	mol::mdb_val value;
+	for (status = mdb_cursor_get (cursor, key, value, MDB_FIRST); status == 0; status = mdb_cursor_get (cursor, key, value, MDB_NEXT))
+	{
+		mol::asset asset;
+		std::copy_n (reinterpret_cast<uint8_t const *> (key.data ()) + sizeof (mol::account), asset.bytes.size (), asset.bytes.begin ());
+		mol::pending_info info;
+		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		auto error (info.deserialize (stream));
+		assert (!error);
+		auto & supply (supplies[asset]);
+		supply.pending = supply.pending.number () + info.amount.number ();
+		supply.modified = now;
+	}
+	assert (status == MDB_NOTFOUND);
+	mdb_cursor_close (cursor);
+	for (auto & i : supplies)
+	{
+		asset_supply_put (transaction_a, i.first, i.second);
+	}
+}
+
+// Sidebands and heights are missing if the tables were just created on a ledger that already has blocks. Each chain is
+// walked from its head down to find the heights, then forward to derive balances and subtypes the way the processor does.
+void mol::ledger::sidebands_build (MDB_txn * transaction_a)
+{
+	MDB_stat sidebands_stat;
+	auto status (mdb_stat (transaction_a, sidebands, &sidebands_stat));
+	assert (status == 0);
+	if (sidebands_stat.ms_entries == 0)
+	{
+		std::vector<mol::block_hash> chain;
+		for (auto i (store.latest_begin (transaction_a)), n (store.latest_end ()); i != n; ++i)
+		{
+			mol::account account (i->first.uint256 ());
+			mol::account_info info (i->second);
+			chain.clear ();
+			for (auto hash (info.head); !hash.is_zero ();)
+			{
+				chain.push_back (hash);
+				auto block (store.block_get (transaction_a, hash));
+				assert (block != nullptr);
+				hash = block->previous ();
+			}
+			mol::uint128_t balance (0);
+			uint64_t height (0);
+			for (auto j (chain.rbegin ()), m (chain.rend ()); j != m; ++j)
+			{
+				auto block (store.block_get (transaction_a, *j));
+				auto previous (balance);
+				auto subtype (mol::block_subtype::unknown);
+				switch (block->type ())
+				{
+					case mol::block_type::send:
+						balance = static_cast<mol::send_block const &> (*block).hashables.balance.number ();
+						subtype = mol::block_subtype::send;
+						break;
+					case mol::block_type::receive:
+						balance = previous + amount (transaction_a, block->source ());
+						subtype = mol::block_subtype::receive;
+						break;
+					case mol::block_type::open:
+						balance = amount (transaction_a, block->source ());
+						subtype = mol::block_subtype::open;
+						break;
+					case mol::block_type::change:
+						subtype = mol::block_subtype::change;
+						break;
+					case mol::block_type::state:
+					{
+						auto const & state (static_cast<mol::state_block const &> (*block));
+						balance = state.hashables.balance.number ();
+						subtype = balance < previous ? mol::block_subtype::send : state.hashables.link.is_zero () ? mol::block_subtype::change : state.hashables.previous.is_zero () ? mol::block_subtype::open : mol::block_subtype::receive;
+						break;
+					}
+					default:
+						assert (false);
+						break;
+				}
+				++height;
+				sideband_put (transaction_a, *j, mol::block_sideband (height, account, balance, subtype, 0));
+				height_put (transaction_a, account, 0, height, *j);
+			}
+		}
+		for (auto i (store.asset_account_begin (transaction_a)), n (store.asset_account_end ()); i != n; ++i)
+		{
+			mol::asset_account_key key (i->first);
+			mol::asset_account_info info (i->second);
+			// The first block of an asset chain follows a block of the native chain
+			chain.clear ();
+			auto hash (info.head);
+			for (uint64_t height (info.block_count); height > 0; --height)
+			{
+				chain.push_back (hash);
+				auto block (store.block_get (transaction_a, hash));
+				assert (block != nullptr && block->type () == mol::block_type::astate);
+				hash = block->previous ();
+			}
+			mol::uint128_t balance (0);
+			uint64_t height (0);
+			for (auto j (chain.rbegin ()), m (chain.rend ()); j != m; ++j)
+			{
+				auto block (store.block_get (transaction_a, *j));
+				auto const & astate (static_cast<mol::astate_block const &> (*block));
+				auto previous (balance);
+				balance = astate.hashables.balance.number ();
+				++height;
+				// Issuing blocks don't receive anything, the first block of any other holder does
+				auto subtype (height == 1 ? astate.hashables.link.is_zero () ? mol::block_subtype::issue : mol::block_subtype::open : balance < previous ? mol::block_subtype::send : mol::block_subtype::receive);
+				sideband_put (transaction_a, *j, mol::block_sideband (height, key.account, balance, subtype, 0));
+				height_put (transaction_a, key.account, key.asset, height, *j);
+			}
+		}
+	}
+}
+
+// Summaries are missing if the table was just created on a ledger that already has pending entries
+void mol::ledger::pending_summaries_build (MDB_txn * transaction_a)
+{
+	MDB_stat summaries_stat;
+	auto status (mdb_stat (transaction_a, pending_summaries, &summaries_stat));
+	assert (status == 0);
+	if (summaries_stat.ms_entries == 0)
+	{
+		mol::account current (0);
+		mol::pending_summary summary;
+		for (auto i (store.pending_begin (transaction_a)), n (store.pending_end ()); i != n; ++i)
+		{
+			mol::pending_key key (i->first);
+			mol::pending_info info (i->second);
+			if (key.account != current)
+			{
+				pending_summary_put (transaction_a, current, summary);
+				current = key.account;
+				summary = mol::pending_summary ();
+			}
+			summary.add (info.amount.number ());
+		}
+		pending_summary_put (transaction_a, current, summary);
+	}
+}
+
+void mol::ledger::verify_signatures (MDB_txn * transaction_a, std::vector<mol::block const *> const & blocks_a)
+{
+	std::vector<mol::signature_check> checks;
+	std::vector<mol::block const *> checked;
+	checks.reserve (blocks_a.size ());
+	checked.reserve (blocks_a.size ());
+	for (auto block : blocks_a)
+	{
+		// State blocks name their signer, legacy blocks are signed by the account whose frontier they extend
+		mol::account account;
+		switch (block->type ())
+		{
+			case mol::block_type::state:
+				account = static_cast<mol::state_block const *> (block)->hashables.account;
+				break;
+			case mol::block_type::astate:
+				account = static_cast<mol::astate_block const *> (block)->hashables.account;
+				break;
+			case mol::block_type::open:
+				account = static_cast<mol::open_block const *> (block)->hashables.account;
+				break;
+			case mol::block_type::send:
+			case mol::block_type::receive:
+			case mol::block_type::change:
+				account = store.frontier_get (transaction_a, block->previous ());
+				break;
+			default:
+				account.clear ();
+				break;
+		}
+		// Unknown signers are left for the processor to report as a gap or fork
+		if (!account.is_zero ())
+		{
+			checks.push_back (mol::signature_check{ block->hash (), account, block->block_signature (), 0 });
+			checked.push_back (block);
+		}
+	}
+	signature_checker.verify (checks);
+	for (size_t i (0), n (checks.size ()); i < n; ++i)
+	{
+		if (checks[i].valid == 1)
+		{
+			checked[i]->signature_verified_set (checks[i].key);
+		}
+	}
+}
+
 mol::process_return mol::ledger::process (MDB_txn * transaction_a, mol::block const & block_a)
 {
+	// Opened before the processor writes so a first load reads the ledger without this block
+	changes_open (transaction_a);
 	ledger_processor processor (*this, transaction_a);
 	block_a.visit (processor);
+	if (processor.result.code == mol::process_result::progress)
+	{
+		++changes.counts[static_cast<size_t> (block_a.type ())];
+		canary_update (transaction_a, block_a.hash (), true);
+	}
+	representation_flush (transaction_a);
+	checksum_flush (transaction_a);
 	return processor.result;
 }
 
+std::vector<mol::process_return> mol::ledger::process_batch (MDB_txn * transaction_a, std::vector<mol::block const *> const & blocks_a)
+{
+	std::vector<mol::process_return> result (blocks_a.size ());
+	changes_open (transaction_a);
+	std::unordered_map<mol::block_hash, bool> existing_blocks;
+	prefetch (transaction_a, blocks_a, existing_blocks);
+	std::map<mol::stat::detail, uint64_t> batch_stats;
+	// Blocks that gapped on a hash, retried as soon as a block with that hash is processed later in the batch
+	std::unordered_multimap<mol::block_hash, size_t> waiting;
+	std::vector<size_t> ready;
+	for (size_t i (0), n (blocks_a.size ()); i < n; ++i)
+	{
+		ready.push_back (i);
+		while (!ready.empty ())
+		{
+			auto index (ready.back ());
+			ready.pop_back ();
+			auto const & block (*blocks_a[index]);
+			ledger_processor processor (*this, transaction_a, &batch_stats, &existing_blocks);
+			block.visit (processor);
+			result[index] = processor.result;
+			switch (result[index].code)
+			{
+				case mol::process_result::progress:
+				{
+					++changes.counts[static_cast<size_t> (block.type ())];
+					canary_update (transaction_a, block.hash (), true);
+					existing_blocks[block.hash ()] = true;
+					auto dependents (waiting.equal_range (block.hash ()));
+					for (auto j (dependents.first); j != dependents.second; ++j)
+					{
+						ready.push_back (j->second);
+					}
+					waiting.erase (dependents.first, dependents.second);
+					break;
+				}
+				case mol::process_result::gap_previous:
+					waiting.insert (std::make_pair (block.previous (), index));
+					break;
+				case mol::process_result::gap_source:
+				{
+					// State blocks name their source in link
+					auto source (block.source ());
+					if (block.type () == mol::block_type::state)
+					{
+						source = static_cast<mol::state_block const &> (block).hashables.link;
+					}
+					else if (block.type () == mol::block_type::astate)
+					{
+						source = static_cast<mol::astate_block const &> (block).hashables.link;
+					}
+					waiting.insert (std::make_pair (source, index));
+					break;
+				}
+				default:
+					break;
+			}
+		}
+	}
+	representation_flush (transaction_a);
+	checksum_flush (transaction_a);
+	for (auto & i : batch_stats)
+	{
+		stats.add (mol::stat::type::ledger, i.first, mol::stat::dir::in, i.second);
+	}
+	return result;
+}
+
+// Look up every block the batch names in key order so neighbouring lookups share pages, the processor answers existence checks from the results
+void mol::ledger::prefetch (MDB_txn * transaction_a, std::vector<mol::block const *> const & blocks_a, std::unordered_map<mol::block_hash, bool> & existing_a)
+{
+	std::vector<mol::block_hash> hashes;
+	hashes.reserve (blocks_a.size () * 3);
+	for (auto block : blocks_a)
+	{
+		hashes.push_back (block->hash ());
+		hashes.push_back (block->previous ());
+		hashes.push_back (block->source ());
+		switch (block->type ())
+		{
+			case mol::block_type::state:
+				hashes.push_back (static_cast<mol::state_block const *> (block)->hashables.link);
+				break;
+			case mol::block_type::astate:
+				hashes.push_back (static_cast<mol::astate_block const *> (block)->hashables.link);
+				break;
+			default:
+				break;
+		}
+	}
+	std::sort (hashes.begin (), hashes.end ());
+	hashes.erase (std::unique (hashes.begin (), hashes.end ()), hashes.end ());
+	existing_a.reserve (hashes.size ());
+	for (auto & i : hashes)
+	{
+		if (!i.is_zero ())
+		{
+			existing_a[i] = store.block_exists (transaction_a, i);
+		}
+	}
+}
+
 mol::block_hash mol::ledger::representative (MDB_txn * transaction_a, mol::block_hash const & hash_a)
 {
 	auto result (representative_calculated (transaction_a, hash_a));
@@ -895,10 +1887,10 @@ mol::block_hash mol::ledger::block_source (MDB_txn * transaction_a, mol::block c
 // Vote weight of an account
 mol::uint128_t mol::ledger::weight (MDB_txn * transaction_a, mol::account const & account_a)
 {
+	state_current (transaction_a);
 	if (check_bootstrap_weights.load ())
 	{
-		auto blocks = store.block_count (transaction_a);
-		if (blocks.sum () < bootstrap_weight_max_blocks)
+		if (block_counters.sum () < bootstrap_weight_max_blocks)
 		{
 			auto weight = bootstrap_weights.find (account_a);
 			if (weight != bootstrap_weights.end ())
@@ -911,139 +1903,564 @@ mol::uint128_t mol::ledger::weight (MDB_txn * transaction_a, mol::account const
 			check_bootstrap_weights = false;
 		}
 	}
-	return store.representation_get (transaction_a, account_a);
+	auto result (rep_weights.get (account_a));
+	if (changes_transaction.load () == transaction_a)
+	{
+		auto existing (changes.weights.find (account_a));
+		if (existing != changes.weights.end ())
+		{
+			result += existing->second;
+		}
+	}
+	return result;
 }
 
 // Rollback blocks until `block_a' doesn't exist
 void mol::ledger::rollback (MDB_txn * transaction_a, mol::block_hash const & block_a)
 {
 	assert (store.block_exists (transaction_a, block_a));
-	auto account_l (account (transaction_a, block_a));
+	changes_open (transaction_a);
+	rollback_planner planner (*this, transaction_a);
+	planner.remove (block_a);
 	rollback_visitor rollback (transaction_a, *this);
-	mol::account_info info;
-	while (store.block_exists (transaction_a, block_a))
+	for (auto & block : planner.order)
 	{
-		auto latest_error (store.account_get (transaction_a, account_l, info));
-		assert (!latest_error);
-		auto block (store.block_get (transaction_a, info.head));
 		block->visit (rollback);
+		--changes.counts[static_cast<size_t> (block->type ())];
+		canary_update (transaction_a, block->hash (), false);
 	}
+	representation_flush (transaction_a);
+	checksum_flush (transaction_a);
 }
 
-// Return account containing hash
-mol::account mol::ledger::account (MDB_txn * transaction_a, mol::block_hash const & hash_a)
+std::vector<mol::asset> mol::ledger::account_assets (MDB_txn * transaction_a, mol::account const & account_a)
 {
-	mol::account result;
-	auto hash (hash_a);
-	mol::block_hash successor (1);
-	mol::block_info block_info;
-	std::unique_ptr<mol::block> block (store.block_get (transaction_a, hash));
-	while (!successor.is_zero () && block->type () != mol::block_type::state && store.block_info_get (transaction_a, successor, block_info))
+	std::vector<mol::asset> result;
+	MDB_cursor * cursor;
+	auto status (mdb_cursor_open (transaction_a, heights, &cursor));
+	assert (status == 0);
+	// Seek past the last height of each chain to land on the next asset of the account, starting after the native chain
+	mol::asset asset (0);
+	auto more (true);
+	while (more)
 	{
-		successor = store.block_successor (transaction_a, hash);
-		if (!successor.is_zero ())
+		height_key seek (account_a, asset, std::numeric_limits<uint64_t>::max ());
+		mol::mdb_val key (seek.val ());
+		mol::mdb_val value;
+		status = mdb_cursor_get (cursor, key, value, MDB_SET_RANGE);
+		assert (status == 0 || status == MDB_NOTFOUND);
+		auto data (reinterpret_cast<uint8_t const *> (key.data ()));
+		more = status == 0 && key.size () == seek.bytes.size () && std::equal (account_a.bytes.begin (), account_a.bytes.end (), data);
+		if (more)
 		{
-			hash = successor;
-			block = store.block_get (transaction_a, hash);
+			std::copy_n (data + sizeof (mol::account), asset.bytes.size (), asset.bytes.begin ());
+			result.push_back (asset);
 		}
 	}
-	if (block->type () == mol::block_type::state)
-	{
-		auto state_block (dynamic_cast<mol::state_block *> (block.get ()));
-		result = state_block->hashables.account;
-	}
-	else if (successor.is_zero ())
-	{
-		result = store.frontier_get (transaction_a, hash);
-	}
-	else
-	{
-		result = block_info.account;
-	}
-	assert (!result.is_zero ());
+	mdb_cursor_close (cursor);
 	return result;
 }
 
-// Return amount decrease or increase for block
-mol::uint128_t mol::ledger::amount (MDB_txn * transaction_a, mol::block_hash const & hash_a)
+void mol::ledger::representation_add (MDB_txn * transaction_a, mol::block_hash const & source_a, mol::uint128_t const & amount_a)
 {
-	amount_visitor amount (transaction_a, store);
-	amount.compute (hash_a);
-	return amount.result;
+	auto source_block (store.block_get (transaction_a, source_a));
+	assert (source_block != nullptr);
+	auto representative (source_block->representative ());
+	changes_open (transaction_a);
+	changes.weights[representative] += amount_a;
+	changes.weights_unsaved.insert (representative);
 }
 
-// Return latest block for account
-mol::block_hash mol::ledger::latest (MDB_txn * transaction_a, mol::account const & account_a)
+// Stored weights are the committed ones plus the transaction's changes, memory is only updated once it commits
+void mol::ledger::representation_flush (MDB_txn * transaction_a)
 {
-	mol::account_info info;
-	auto latest_error (store.account_get (transaction_a, account_a, info));
-	return latest_error ? 0 : info.head;
+	changes_open (transaction_a);
+	for (auto & i : changes.weights_unsaved)
+	{
+		store.representation_put (transaction_a, i, rep_weights.get (i) + changes.weights[i]);
+	}
+	changes.weights_unsaved.clear ();
 }
 
-// Return latest root for account, account number of there are no blocks for this account.
-mol::block_hash mol::ledger::latest_root (MDB_txn * transaction_a, mol::account const & account_a)
+mol::block_counts mol::ledger::block_count (MDB_txn * transaction_a)
 {
-	mol::account_info info;
-	auto latest_error (store.account_get (transaction_a, account_a, info));
-	mol::block_hash result;
-	if (latest_error)
-	{
-		result = account_a;
-	}
-	else
+	state_current (transaction_a);
+	auto result (block_counters.get ());
+	if (changes_transaction.load () == transaction_a)
 	{
-		result = info.head;
+		result.send += changes.counts[static_cast<size_t> (mol::block_type::send)];
+		result.receive += changes.counts[static_cast<size_t> (mol::block_type::receive)];
+		result.open += changes.counts[static_cast<size_t> (mol::block_type::open)];
+		result.change += changes.counts[static_cast<size_t> (mol::block_type::change)];
+		result.state += changes.counts[static_cast<size_t> (mol::block_type::state)];
+		result.astate += changes.counts[static_cast<size_t> (mol::block_type::astate)];
 	}
 	return result;
 }
 
-mol::checksum mol::ledger::checksum (MDB_txn * transaction_a, mol::account const & begin_a, mol::account const & end_a)
+std::vector<std::pair<mol::account, mol::uint128_t>> mol::ledger::representation_list (MDB_txn * transaction_a)
 {
-	mol::checksum result;
-	auto error (store.checksum_get (transaction_a, 0, 0, result));
-	assert (!error);
+	state_current (transaction_a);
+	auto result (rep_weights.list ());
+	if (changes_transaction.load () == transaction_a && !changes.weights.empty ())
+	{
+		std::map<mol::account, mol::uint128_t> weights (result.begin (), result.end ());
+		for (auto & i : changes.weights)
+		{
+			weights[i.first] += i.second;
+		}
+		result.clear ();
+		for (auto & i : weights)
+		{
+			if (!i.second.is_zero ())
+			{
+				result.push_back (i);
+			}
+		}
+	}
 	return result;
 }
 
-void mol::ledger::dump_account_chain (mol::account const & account_a)
+void mol::ledger::state_current (MDB_txn * transaction_a)
 {
-	mol::transaction transaction (store.environment, nullptr, false);
-	auto hash (latest (transaction, account_a));
-	while (!hash.is_zero ())
+	if (!state_loaded.load ())
 	{
-		auto block (store.block_get (transaction, hash));
-		assert (block != nullptr);
-		std::cerr << hash.to_string () << std::endl;
-		hash = block->previous ();
+		std::lock_guard<std::mutex> lock (changes_mutex);
+		state_load (transaction_a);
 	}
 }
 
-bool mol::ledger::state_block_parsing_enabled (MDB_txn * transaction_a)
-{
-	return store.block_exists (transaction_a, state_block_parse_canary);
-}
-
-bool mol::ledger::state_block_generation_enabled (MDB_txn * transaction_a)
+// Loaded on first use after the node has initialized the genesis block. A write transaction that changes the ledger loads
+// before making its first change, so the load never includes uncommitted changes.
+void mol::ledger::state_load (MDB_txn * transaction_a)
 {
-	return state_block_parsing_enabled (transaction_a) && store.block_exists (transaction_a, state_block_generate_canary);
+	if (!state_loaded.load ())
+	{
+		std::unordered_map<mol::account, mol::uint128_t> weights;
+		for (auto i (store.representation_begin (transaction_a)), n (store.representation_end ()); i != n; ++i)
+		{
+			mol::account account (i->first.uint256 ());
+			weights[account] = store.representation_get (transaction_a, account);
+		}
+		rep_weights.put (weights);
+		block_counters.load (store.block_count (transaction_a));
+		std::array<mol::checksum, mol::ledger_checksums::buckets> values;
+		std::bitset<mol::ledger_checksums::buckets> missing;
+		for (size_t i (0); i < values.size (); ++i)
+		{
+			values[i].clear ();
+			missing[i] = store.checksum_get (transaction_a, static_cast<uint64_t> (i) << 56, 8, values[i]);
+		}
+		if (missing.any ())
+		{
+			// Buckets have not been stored yet, compute them all from the account heads
+			for (auto & i : values)
+			{
+				i.clear ();
+			}
+			for (auto i (store.latest_begin (transaction_a)), n (store.latest_end ()); i != n; ++i)
+			{
+				mol::account account (i->first.uint256 ());
+				mol::account_info info (i->second);
+				values[mol::ledger_checksums::bucket (account)] ^= info.head;
+			}
+			missing.set ();
+		}
+		checksums.load (values, missing);
+		// Canaries stored outside of process, like the genesis block, are only seen here
+		state_block_parse_canary_exists = store.block_exists (transaction_a, state_block_parse_canary);
+		state_block_generate_canary_exists = store.block_exists (transaction_a, state_block_generate_canary);
+		state_loaded = true;
+	}
 }
 
-void mol::ledger::checksum_update (MDB_txn * transaction_a, mol::block_hash const & hash_a)
+void mol::ledger::changes_open (MDB_txn * transaction_a)
 {
-	mol::checksum value;
-	auto error (store.checksum_get (transaction_a, 0, 0, value));
-	assert (!error);
-	value ^= hash_a;
-	store.checksum_put (transaction_a, 0, 0, value);
+	if (changes_transaction.load () != transaction_a)
+	{
+		std::unique_lock<std::mutex> lock (changes_mutex);
+		// The owner of the previous write transaction publishes its changes right after committing it, calculating from
+		// memory before then would miss them
+		changes_condition.wait (lock, [this]() { return changes_transaction.load () == nullptr; });
+		state_load (transaction_a);
+		changes_transaction = transaction_a;
+	}
 }
 
-void mol::ledger::change_latest (MDB_txn * transaction_a, mol::account const & account_a, mol::block_hash const & hash_a, mol::block_hash const & rep_block_a, mol::amount const & balance_a, uint64_t block_count_a, bool is_state)
+mol::uint128_t mol::ledger::weight_stored (MDB_txn * transaction_a, mol::account const & account_a)
+{
+	if (check_bootstrap_weights.load () && block_count_stored (transaction_a).sum () < bootstrap_weight_max_blocks)
+	{
+		auto weight = bootstrap_weights.find (account_a);
+		if (weight != bootstrap_weights.end ())
+		{
+			return weight->second;
+		}
+	}
+	return store.representation_get (transaction_a, account_a);
+}
+
+mol::block_counts mol::ledger::block_count_stored (MDB_txn * transaction_a)
+{
+	return store.block_count (transaction_a);
+}
+
+std::vector<std::pair<mol::account, mol::uint128_t>> mol::ledger::representation_list_stored (MDB_txn * transaction_a)
+{
+	std::vector<std::pair<mol::account, mol::uint128_t>> result;
+	for (auto i (store.representation_begin (transaction_a)), n (store.representation_end ()); i != n; ++i)
+	{
+		mol::account account (i->first.uint256 ());
+		result.push_back (std::make_pair (account, store.representation_get (transaction_a, account)));
+	}
+	return result;
+}
+
+void mol::ledger::committed (MDB_txn * transaction_a)
+{
+	if (changes_transaction.load () == transaction_a)
+	{
+		{
+			std::lock_guard<std::mutex> lock (changes_mutex);
+			changes_publish ();
+			changes.clear ();
+			changes_transaction = nullptr;
+		}
+		changes_condition.notify_all ();
+	}
+}
+
+void mol::ledger::changes_publish ()
+{
+	std::unordered_map<mol::account, mol::uint128_t> weights;
+	for (auto & i : changes.weights)
+	{
+		if (!i.second.is_zero ())
+		{
+			weights[i.first] = rep_weights.get (i.first) + i.second;
+		}
+	}
+	if (!weights.empty ())
+	{
+		rep_weights.put (weights);
+	}
+	for (size_t i (0); i < changes.counts.size (); ++i)
+	{
+		if (changes.counts[i] != 0)
+		{
+			block_counters.add (static_cast<mol::block_type> (i), changes.counts[i]);
+		}
+	}
+	checksums.apply (changes.checksums, changes.checksums_changed, changes.checksums_saved, changes.checksums_unsaved);
+	for (auto & i : changes.canaries)
+	{
+		if (i.first == state_block_parse_canary)
+		{
+			state_block_parse_canary_exists = i.second;
+		}
+		if (i.first == state_block_generate_canary)
+		{
+			state_block_generate_canary_exists = i.second;
+		}
+	}
+}
+
+// Return account containing hash
+mol::account mol::ledger::account (MDB_txn * transaction_a, mol::block_hash const & hash_a)
+{
+	mol::account result;
+	mol::block_sideband sideband;
+	if (!sideband_get (transaction_a, hash_a, sideband))
+	{
+		result = sideband.account;
+	}
+	else
+	{
+		// Blocks stored before the sideband table existed, walk forward to a block that records its account
+		auto hash (hash_a);
+		mol::block_hash successor (1);
+		mol::block_info block_info;
+		std::unique_ptr<mol::block> block (store.block_get (transaction_a, hash));
+		while (!successor.is_zero () && block->type () != mol::block_type::state && store.block_info_get (transaction_a, successor, block_info))
+		{
+			successor = store.block_successor (transaction_a, hash);
+			if (!successor.is_zero ())
+			{
+				hash = successor;
+				block = store.block_get (transaction_a, hash);
+			}
+		}
+		if (block->type () == mol::block_type::state)
+		{
+			auto state_block (dynamic_cast<mol::state_block *> (block.get ()));
+			result = state_block->hashables.account;
+		}
+		else if (successor.is_zero ())
+		{
+			result = store.frontier_get (transaction_a, hash);
+		}
+		else
+		{
+			result = block_info.account;
+		}
+	}
+	assert (!result.is_zero ());
+	return result;
+}
+
+// Return amount decrease or increase for block
+mol::uint128_t mol::ledger::amount (MDB_txn * transaction_a, mol::block_hash const & hash_a)
+{
+	mol::uint128_t result;
+	auto found (false);
+	mol::block_sideband sideband;
+	if (!sideband_get (transaction_a, hash_a, sideband))
+	{
+		switch (sideband.subtype)
+		{
+			case mol::block_subtype::open:
+			case mol::block_subtype::issue:
+				result = sideband.balance.number ();
+				found = true;
+				break;
+			case mol::block_subtype::change:
+				result = 0;
+				found = true;
+				break;
+			case mol::block_subtype::send:
+			case mol::block_subtype::receive:
+			{
+				auto block (store.block_get (transaction_a, hash_a));
+				assert (block != nullptr);
+				mol::block_sideband previous;
+				if (!sideband_get (transaction_a, block->previous (), previous))
+				{
+					auto before (previous.balance.number ());
+					auto after (sideband.balance.number ());
+					result = sideband.subtype == mol::block_subtype::send ? before - after : after - before;
+					found = true;
+				}
+				break;
+			}
+			case mol::block_subtype::unknown:
+				break;
+		}
+	}
+	if (!found)
+	{
+		amount_visitor amount (transaction_a, store);
+		amount.compute (hash_a);
+		result = amount.result;
+	}
+	return result;
+}
+
+bool mol::ledger::sideband_get (MDB_txn * transaction_a, mol::block_hash const & hash_a, mol::block_sideband & sideband_a)
+{
+	mol::mdb_val value;
+	auto status (mdb_get (transaction_a, sidebands, mol::mdb_val (hash_a), value));
+	assert (status == 0 || status == MDB_NOTFOUND);
+	bool result (true);
+	if (status == 0)
+	{
+		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (value.data ()), value.size ());
+		result = sideband_a.deserialize (stream);
+		assert (!result);
+	}
+	return result;
+}
+
+void mol::ledger::sideband_put (MDB_txn * transaction_a, mol::block_hash const & hash_a, mol::block_sideband const & sideband_a)
+{
+	std::vector<uint8_t> bytes;
+	{
+		mol::vectorstream stream (bytes);
+		sideband_a.serialize (stream);
+	}
+	auto status (mdb_put (transaction_a, sidebands, mol::mdb_val (hash_a), mol::mdb_val (bytes.size (), bytes.data ()), 0));
+	assert (status == 0);
+}
+
+void mol::ledger::sideband_del (MDB_txn * transaction_a, mol::block_hash const & hash_a)
+{
+	auto status (mdb_del (transaction_a, sidebands, mol::mdb_val (hash_a), nullptr));
+	assert (status == 0 || status == MDB_NOTFOUND);
+}
+
+void mol::ledger::height_put (MDB_txn * transaction_a, mol::account const & account_a, mol::asset const & asset_a, uint64_t height_a, mol::block_hash const & hash_a)
+{
+	height_key key (account_a, asset_a, height_a);
+	auto status (mdb_put (transaction_a, heights, key.val (), mol::mdb_val (hash_a), 0));
+	assert (status == 0);
+}
+
+void mol::ledger::height_del (MDB_txn * transaction_a, mol::account const & account_a, mol::asset const & asset_a, uint64_t height_a)
+{
+	height_key key (account_a, asset_a, height_a);
+	auto status (mdb_del (transaction_a, heights, key.val (), nullptr));
+	assert (status == 0 || status == MDB_NOTFOUND);
+}
+
+bool mol::ledger::block_at_height (MDB_txn * transaction_a, mol::block_hash const & head_a, uint64_t height_a, mol::block_hash & hash_a)
+{
+	mol::block_sideband sideband;
+	auto result (sideband_get (transaction_a, head_a, sideband));
+	if (!result)
+	{
+		result = height_a == 0 || height_a > sideband.height;
+		if (!result)
+		{
+			mol::asset asset (0);
+			auto head (store.block_get (transaction_a, head_a));
+			assert (head != nullptr);
+			if (head->type () == mol::block_type::astate)
+			{
+				asset = static_cast<mol::astate_block const &> (*head).hashables.asset;
+			}
+			height_key key (sideband.account, asset, height_a);
+			mol::mdb_val value;
+			auto status (mdb_get (transaction_a, heights, key.val (), value));
+			assert (status == 0 || status == MDB_NOTFOUND);
+			result = status != 0;
+			if (!result)
+			{
+				hash_a = value.uint256 ();
+			}
+		}
+	}
+	return result;
+}
+
+// Return latest block for account
+mol::block_hash mol::ledger::latest (MDB_txn * transaction_a, mol::account const & account_a)
+{
+	mol::account_info info;
+	auto latest_error (store.account_get (transaction_a, account_a, info));
+	return latest_error ? 0 : info.head;
+}
+
+// Return latest root for account, account number of there are no blocks for this account.
+mol::block_hash mol::ledger::latest_root (MDB_txn * transaction_a, mol::account const & account_a)
+{
+	mol::account_info info;
+	auto latest_error (store.account_get (transaction_a, account_a, info));
+	mol::block_hash result;
+	if (latest_error)
+	{
+		result = account_a;
+	}
+	else
+	{
+		result = info.head;
+	}
+	return result;
+}
+
+mol::checksum mol::ledger::checksum (MDB_txn * transaction_a, mol::account const & begin_a, mol::account const & end_a)
+{
+	// Ranges that split a bucket would silently include accounts outside of them
+	assert (std::all_of (begin_a.bytes.begin () + 1, begin_a.bytes.end (), [](uint8_t byte_a) { return byte_a == 0; }));
+	assert (std::all_of (end_a.bytes.begin () + 1, end_a.bytes.end (), [](uint8_t byte_a) { return byte_a == 0xff; }));
+	state_current (transaction_a);
+	auto first (mol::ledger_checksums::bucket (begin_a));
+	auto last (mol::ledger_checksums::bucket (end_a));
+	auto result (checksums.get (first, last));
+	if (changes_transaction.load () == transaction_a)
+	{
+		for (auto i (first); i <= last; ++i)
+		{
+			result ^= changes.checksums[i];
+		}
+	}
+	return result;
+}
+
+void mol::ledger::dump_account_chain (mol::account const & account_a)
+{
+	mol::transaction transaction (store.environment, nullptr, false);
+	auto hash (latest (transaction, account_a));
+	while (!hash.is_zero ())
+	{
+		auto block (store.block_get (transaction, hash));
+		assert (block != nullptr);
+		std::cerr << hash.to_string () << std::endl;
+		hash = block->previous ();
+	}
+}
+
+bool mol::ledger::state_block_parsing_enabled (MDB_txn * transaction_a)
+{
+	return canary_exists (transaction_a, state_block_parse_canary, state_block_parse_canary_exists);
+}
+
+bool mol::ledger::state_block_generation_enabled (MDB_txn * transaction_a)
+{
+	return state_block_parsing_enabled (transaction_a) && canary_exists (transaction_a, state_block_generate_canary, state_block_generate_canary_exists);
+}
+
+bool mol::ledger::canary_exists (MDB_txn * transaction_a, mol::block_hash const & hash_a, std::atomic<bool> const & committed_a)
+{
+	state_current (transaction_a);
+	auto result (committed_a.load ());
+	if (changes_transaction.load () == transaction_a)
+	{
+		auto existing (changes.canaries.find (hash_a));
+		if (existing != changes.canaries.end ())
+		{
+			result = existing->second;
+		}
+	}
+	return result;
+}
+
+void mol::ledger::canary_update (MDB_txn * transaction_a, mol::block_hash const & hash_a, bool exists_a)
+{
+	if (hash_a == state_block_parse_canary || hash_a == state_block_generate_canary)
+	{
+		changes_open (transaction_a);
+		changes.canaries[hash_a] = exists_a;
+	}
+}
+
+void mol::ledger::checksum_update (MDB_txn * transaction_a, mol::account const & account_a, mol::block_hash const & hash_a)
+{
+	auto bucket (mol::ledger_checksums::bucket (account_a));
+	changes_open (transaction_a);
+	changes.checksums[bucket] ^= hash_a;
+	changes.checksums_changed.set (bucket);
+	changes.checksums_unsaved.set (bucket);
+}
+
+// Stored buckets are the committed ones with the transaction's changes XORed in, memory is only updated once it commits
+void mol::ledger::checksum_flush (MDB_txn * transaction_a)
+{
+	changes_open (transaction_a);
+	auto buckets (changes.checksums_unsaved | (checksums.unsaved_buckets () & ~changes.checksums_saved));
+	if (buckets.any ())
+	{
+		mol::checksum total (checksums.get (0, mol::ledger_checksums::buckets - 1));
+		for (size_t i (0); i < mol::ledger_checksums::buckets; ++i)
+		{
+			total ^= changes.checksums[i];
+			if (buckets[i])
+			{
+				// Buckets are keyed by their top byte with an 8 bit mask
+				store.checksum_put (transaction_a, static_cast<uint64_t> (i) << 56, 8, checksums.get (i, i) ^ changes.checksums[i]);
+			}
+		}
+		store.checksum_put (transaction_a, 0, 0, total);
+		changes.checksums_saved |= buckets;
+		changes.checksums_unsaved.reset ();
+	}
+}
+
+void mol::ledger::change_latest (MDB_txn * transaction_a, mol::account const & account_a, mol::block_hash const & hash_a, mol::block_hash const & rep_block_a, mol::amount const & balance_a, uint64_t block_count_a, bool is_state)
 {
 	mol::account_info info;
 	auto exists (!store.account_get (transaction_a, account_a, info));
 	if (exists)
 	{
-		checksum_update (transaction_a, info.head);
+		checksum_update (transaction_a, account_a, info.head);
 	}
 	else
 	{
@@ -1065,7 +2482,7 @@ void mol::ledger::change_latest (MDB_txn * transaction_a, mol::account const & a
 			block_info.balance = balance_a;
 			store.block_info_put (transaction_a, hash_a, block_info);
 		}
-		checksum_update (transaction_a, hash_a);
+		checksum_update (transaction_a, account_a, hash_a);
 	}
 	else
 	{
@@ -1112,3 +2529,594 @@ std::unique_ptr<mol::block> mol::ledger::forked_block (MDB_txn * transaction_a,
 	}
 	return result;
 }
+
+mol::signature_checker::signature_checker (unsigned threads_a) :
+stopped (false)
+{
+	for (unsigned i (0); i < threads_a; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
+}
+
+mol::signature_checker::~signature_checker ()
+{
+	stop ();
+}
+
+void mol::signature_checker::verify (std::vector<mol::signature_check> & checks_a)
+{
+	size_t remaining (0);
+	std::unique_lock<std::mutex> lock (mutex);
+	for (size_t begin (0), n (checks_a.size ()); begin < n; begin += batch_size)
+	{
+		auto end (std::min (begin + batch_size, n));
+		++remaining;
+		tasks.push_back ([this, &checks_a, &remaining, begin, end]() {
+			std::array<unsigned char const *, batch_size> messages;
+			std::array<size_t, batch_size> lengths;
+			std::array<unsigned char const *, batch_size> keys;
+			std::array<unsigned char const *, batch_size> signatures;
+			std::array<int, batch_size> valid;
+			for (auto i (begin); i < end; ++i)
+			{
+				auto & check (checks_a[i]);
+				messages[i - begin] = check.message.bytes.data ();
+				lengths[i - begin] = check.message.bytes.size ();
+				keys[i - begin] = check.key.bytes.data ();
+				signatures[i - begin] = check.signature.bytes.data ();
+			}
+			ed25519_sign_open_batch (messages.data (), lengths.data (), keys.data (), signatures.data (), end - begin, valid.data ());
+			for (auto i (begin); i < end; ++i)
+			{
+				checks_a[i].valid = valid[i - begin];
+			}
+			std::lock_guard<std::mutex> lock (mutex);
+			if (--remaining == 0)
+			{
+				condition.notify_all ();
+			}
+		});
+	}
+	condition.notify_all ();
+	// Without workers, or once stopped, the caller drains the queue itself
+	while (remaining > 0)
+	{
+		if ((threads.empty () || stopped) && !tasks.empty ())
+		{
+			auto task (std::move (tasks.front ()));
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+void mol::signature_checker::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+	}
+	condition.notify_all ();
+	for (auto & i : threads)
+	{
+		if (i.joinable ())
+		{
+			i.join ();
+		}
+	}
+}
+
+void mol::signature_checker::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!tasks.empty ())
+		{
+			auto task (std::move (tasks.front ()));
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+mol::rep_weights::rep_weights () :
+current (std::make_shared<snapshot> ())
+{
+}
+
+mol::uint128_t mol::rep_weights::get (mol::account const & account_a) const
+{
+	mol::uint128_t result (0);
+	auto snapshot_l (std::atomic_load (&current));
+	auto existing (snapshot_l->overlay.find (account_a));
+	if (existing != snapshot_l->overlay.end ())
+	{
+		result = existing->second;
+	}
+	else if (snapshot_l->base != nullptr)
+	{
+		auto existing (snapshot_l->base->find (account_a));
+		if (existing != snapshot_l->base->end ())
+		{
+			result = existing->second;
+		}
+	}
+	return result;
+}
+
+std::vector<std::pair<mol::account, mol::uint128_t>> mol::rep_weights::list () const
+{
+	auto snapshot_l (std::atomic_load (&current));
+	std::vector<std::pair<mol::account, mol::uint128_t>> result (snapshot_l->overlay.begin (), snapshot_l->overlay.end ());
+	if (snapshot_l->base != nullptr)
+	{
+		for (auto & i : *snapshot_l->base)
+		{
+			if (snapshot_l->overlay.find (i.first) == snapshot_l->overlay.end ())
+			{
+				result.push_back (i);
+			}
+		}
+	}
+	std::sort (result.begin (), result.end (), [](std::pair<mol::account, mol::uint128_t> const & lhs, std::pair<mol::account, mol::uint128_t> const & rhs) {
+		return lhs.first < rhs.first;
+	});
+	return result;
+}
+
+void mol::rep_weights::put (std::unordered_map<mol::account, mol::uint128_t> const & weights_a)
+{
+	std::lock_guard<std::mutex> lock (writer_mutex);
+	auto previous (std::atomic_load (&current));
+	auto next (std::make_shared<snapshot> ());
+	next->base = previous->base;
+	next->overlay = previous->overlay;
+	for (auto & i : weights_a)
+	{
+		next->overlay[i.first] = i.second;
+	}
+	if (next->overlay.size () > overlay_max)
+	{
+		// Fold the overlay into a new base so lookups and the next publish stay cheap
+		auto base (next->base != nullptr ? std::make_shared<weights_t> (*next->base) : std::make_shared<weights_t> ());
+		for (auto & i : next->overlay)
+		{
+			(*base)[i.first] = i.second;
+		}
+		next->base = base;
+		next->overlay.clear ();
+	}
+	std::atomic_store (&current, std::shared_ptr<snapshot const> (next));
+}
+
+mol::block_counters::block_counters ()
+{
+	for (auto & i : counts)
+	{
+		i = 0;
+	}
+}
+
+void mol::block_counters::load (mol::block_counts const & counts_a)
+{
+	counts[static_cast<size_t> (mol::block_type::send)] = counts_a.send;
+	counts[static_cast<size_t> (mol::block_type::receive)] = counts_a.receive;
+	counts[static_cast<size_t> (mol::block_type::open)] = counts_a.open;
+	counts[static_cast<size_t> (mol::block_type::change)] = counts_a.change;
+	counts[static_cast<size_t> (mol::block_type::state)] = counts_a.state;
+	counts[static_cast<size_t> (mol::block_type::astate)] = counts_a.astate;
+}
+
+void mol::block_counters::add (mol::block_type type_a, uint64_t count_a)
+{
+	counts[static_cast<size_t> (type_a)] += count_a;
+}
+
+void mol::block_counters::subtract (mol::block_type type_a, uint64_t count_a)
+{
+	counts[static_cast<size_t> (type_a)] -= count_a;
+}
+
+mol::block_counts mol::block_counters::get () const
+{
+	mol::block_counts result;
+	result.send = counts[static_cast<size_t> (mol::block_type::send)];
+	result.receive = counts[static_cast<size_t> (mol::block_type::receive)];
+	result.open = counts[static_cast<size_t> (mol::block_type::open)];
+	result.change = counts[static_cast<size_t> (mol::block_type::change)];
+	result.state = counts[static_cast<size_t> (mol::block_type::state)];
+	result.astate = counts[static_cast<size_t> (mol::block_type::astate)];
+	return result;
+}
+
+uint64_t mol::block_counters::sum () const
+{
+	uint64_t result (0);
+	for (auto & i : counts)
+	{
+		result += i;
+	}
+	return result;
+}
+
+mol::vote_tally::vote_tally (mol::ledger & ledger_a) :
+ledger (ledger_a)
+{
+}
+
+void mol::vote_tally::vote (MDB_txn * transaction_a, mol::account const & rep_a, std::shared_ptr<mol::block> block_a)
+{
+	auto existing (votes.find (rep_a));
+	auto hash (existing != votes.end () && existing->second.block == block_a ? existing->second.hash : block_a->hash ());
+	if (existing == votes.end () || existing->second.hash != hash)
+	{
+		if (existing != votes.end ())
+		{
+			// Withdraw exactly the weight this representative contributed before
+			move (existing->second.hash, existing->second.weight, false);
+		}
+		auto weight (ledger.weight (transaction_a, rep_a));
+		auto candidate_l (candidates.find (hash));
+		if (candidate_l == candidates.end ())
+		{
+			candidates.insert (std::make_pair (hash, candidate{ block_a, 0 }));
+			order.insert (std::make_pair (mol::uint128_t (0), hash));
+		}
+		move (hash, weight, true);
+		votes[rep_a] = vote_entry{ block_a, hash, weight };
+	}
+}
+
+void mol::vote_tally::move (mol::block_hash const & hash_a, mol::uint128_t const & weight_a, bool add_a)
+{
+	auto & candidate_l (candidates[hash_a]);
+	order.erase (std::make_pair (candidate_l.total, hash_a));
+	candidate_l.total = add_a ? candidate_l.total + weight_a : candidate_l.total - weight_a;
+	order.insert (std::make_pair (candidate_l.total, hash_a));
+}
+
+std::pair<mol::uint128_t, std::shared_ptr<mol::block>> mol::vote_tally::winner () const
+{
+	std::pair<mol::uint128_t, std::shared_ptr<mol::block>> result (0, nullptr);
+	if (!order.empty ())
+	{
+		auto const & leader (*order.begin ());
+		result = std::make_pair (leader.first, candidates.find (leader.second)->second.block);
+	}
+	return result;
+}
+
+bool mol::vote_tally::have_quorum (mol::uint128_t const & delta_a) const
+{
+	auto result (false);
+	if (!order.empty ())
+	{
+		auto first (order.begin ());
+		auto second (std::next (first));
+		mol::uint128_t runner_up (second != order.end () ? second->first : 0);
+		result = first->first - runner_up >= delta_a;
+	}
+	return result;
+}
+
+mol::uint128_t mol::vote_tally::total (mol::block_hash const & hash_a) const
+{
+	auto existing (candidates.find (hash_a));
+	return existing != candidates.end () ? existing->second.total : mol::uint128_t (0);
+}
+
+mol::tally_t mol::vote_tally::tally () const
+{
+	mol::tally_t result;
+	for (auto & i : order)
+	{
+		// Skip candidates every voter has moved away from
+		if (i.first != 0)
+		{
+			result.insert (result.end (), std::make_pair (i.first, candidates.find (i.second)->second.block));
+		}
+	}
+	return result;
+}
+
+size_t mol::vote_tally::size () const
+{
+	return votes.size ();
+}
+
+mol::block_sideband::block_sideband () :
+height (0),
+account (0),
+balance (0),
+subtype (mol::block_subtype::unknown),
+timestamp (0)
+{
+}
+
+mol::block_sideband::block_sideband (uint64_t height_a, mol::account const & account_a, mol::amount const & balance_a, mol::block_subtype subtype_a, uint64_t timestamp_a) :
+height (height_a),
+account (account_a),
+balance (balance_a),
+subtype (subtype_a),
+timestamp (timestamp_a)
+{
+}
+
+void mol::block_sideband::serialize (mol::stream & stream_a) const
+{
+	mol::write (stream_a, height);
+	mol::write (stream_a, account.bytes);
+	mol::write (stream_a, balance.bytes);
+	mol::write (stream_a, static_cast<uint8_t> (subtype));
+	mol::write (stream_a, timestamp);
+}
+
+bool mol::block_sideband::deserialize (mol::stream & stream_a)
+{
+	auto error (mol::read (stream_a, height));
+	if (!error)
+	{
+		error = mol::read (stream_a, account.bytes);
+		if (!error)
+		{
+			error = mol::read (stream_a, balance.bytes);
+			if (!error)
+			{
+				uint8_t subtype_l;
+				error = mol::read (stream_a, subtype_l);
+				if (!error)
+				{
+					subtype = static_cast<mol::block_subtype> (subtype_l);
+					error = mol::read (stream_a, timestamp);
+				}
+			}
+		}
+	}
+	return error;
+}
+
+mol::pending_summary::pending_summary () :
+count (0),
+total (0),
+max (0),
+max_count (0)
+{
+}
+
+void mol::pending_summary::add (mol::uint128_t const & amount_a)
+{
+	count += 1;
+	total = total.number () + amount_a;
+	// An upper bound left by remove () becomes exact again once an amount reaches it
+	if (amount_a > max.number () || (amount_a == max.number () && max_count == 0))
+	{
+		max = amount_a;
+		max_count = 1;
+	}
+	else if (amount_a == max.number ())
+	{
+		max_count += 1;
+	}
+}
+
+void mol::pending_summary::remove (mol::uint128_t const & amount_a)
+{
+	assert (count > 0);
+	count -= 1;
+	total = total.number () - amount_a;
+	if (amount_a == max.number () && max_count > 0)
+	{
+		max_count -= 1;
+	}
+	if (count == 0)
+	{
+		max = 0;
+		max_count = 0;
+	}
+}
+
+void mol::pending_summary::serialize (mol::stream & stream_a) const
+{
+	mol::write (stream_a, count);
+	mol::write (stream_a, total.bytes);
+	mol::write (stream_a, max.bytes);
+	mol::write (stream_a, max_count);
+}
+
+bool mol::pending_summary::deserialize (mol::stream & stream_a)
+{
+	auto error (mol::read (stream_a, count));
+	if (!error)
+	{
+		error = mol::read (stream_a, total.bytes);
+		if (!error)
+		{
+			error = mol::read (stream_a, max.bytes);
+			if (!error)
+			{
+				error = mol::read (stream_a, max_count);
+			}
+		}
+	}
+	return error;
+}
+
+mol::asset_supply::asset_supply () :
+total (0),
+holders (0),
+pending (0),
+modified (0)
+{
+}
+
+void mol::asset_supply::serialize (mol::stream & stream_a) const
+{
+	mol::write (stream_a, total.bytes);
+	mol::write (stream_a, holders);
+	mol::write (stream_a, pending.bytes);
+	mol::write (stream_a, modified);
+}
+
+bool mol::asset_supply::deserialize (mol::stream & stream_a)
+{
+	auto error (mol::read (stream_a, total.bytes));
+	if (!error)
+	{
+		error = mol::read (stream_a, holders);
+		if (!error)
+		{
+			error = mol::read (stream_a, pending.bytes);
+			if (!error)
+			{
+				error = mol::read (stream_a, modified);
+			}
+		}
+	}
+	return error;
+}
+
+mol::asset_account_state::asset_account_state () :
+account_exists (false),
+asset_exists (false),
+asset_account_exists (false)
+{
+}
+
+mol::astate_timing::astate_timing ()
+{
+	for (auto & i : counts)
+	{
+		i = 0;
+	}
+	for (auto & i : times)
+	{
+		i = 0;
+	}
+}
+
+void mol::astate_timing::add (mol::astate_timing::step step_a, std::chrono::steady_clock::duration const & duration_a)
+{
+	auto index (static_cast<size_t> (step_a));
+	counts[index].fetch_add (1, std::memory_order_relaxed);
+	times[index].fetch_add (std::chrono::duration_cast<std::chrono::nanoseconds> (duration_a).count (), std::memory_order_relaxed);
+}
+
+uint64_t mol::astate_timing::count (mol::astate_timing::step step_a) const
+{
+	return counts[static_cast<size_t> (step_a)].load (std::memory_order_relaxed);
+}
+
+uint64_t mol::astate_timing::nanoseconds (mol::astate_timing::step step_a) const
+{
+	return times[static_cast<size_t> (step_a)].load (std::memory_order_relaxed);
+}
+
+char const * mol::astate_timing::name (mol::astate_timing::step step_a)
+{
+	char const * result ("");
+	switch (step_a)
+	{
+		case mol::astate_timing::step::signature:
+			result = "signature";
+			break;
+		case mol::astate_timing::step::lookup:
+			result = "lookup";
+			break;
+		case mol::astate_timing::step::previous:
+			result = "previous";
+			break;
+		case mol::astate_timing::step::source:
+			result = "source";
+			break;
+		case mol::astate_timing::step::write:
+			result = "write";
+			break;
+	}
+	return result;
+}
+
+mol::ledger_checksums::ledger_checksums ()
+{
+	for (auto & i : values)
+	{
+		i.clear ();
+	}
+}
+
+mol::checksum mol::ledger_checksums::get (size_t first_a, size_t last_a) const
+{
+	assert (first_a <= last_a && last_a < buckets);
+	mol::checksum result (0);
+	std::lock_guard<std::mutex> lock (mutex);
+	for (auto i (first_a); i <= last_a; ++i)
+	{
+		result ^= values[i];
+	}
+	return result;
+}
+
+void mol::ledger_checksums::load (std::array<mol::checksum, buckets> const & values_a, std::bitset<buckets> const & missing_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	values = values_a;
+	unsaved = missing_a;
+}
+
+void mol::ledger_checksums::apply (std::array<mol::checksum, buckets> const & deltas_a, std::bitset<buckets> const & changed_a, std::bitset<buckets> const & saved_a, std::bitset<buckets> const & unsaved_a)
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	for (size_t i (0); i < buckets; ++i)
+	{
+		if (changed_a[i])
+		{
+			values[i] ^= deltas_a[i];
+		}
+	}
+	unsaved = (unsaved & ~saved_a) | unsaved_a;
+}
+
+std::bitset<mol::ledger_checksums::buckets> mol::ledger_checksums::unsaved_buckets () const
+{
+	std::lock_guard<std::mutex> lock (mutex);
+	return unsaved;
+}
+
+size_t mol::ledger_checksums::bucket (mol::account const & account_a)
+{
+	// Account numbers are stored most significant byte first
+	return account_a.bytes[0];
+}
+
+mol::ledger_changes::ledger_changes ()
+{
+	clear ();
+}
+
+void mol::ledger_changes::clear ()
+{
+	weights.clear ();
+	weights_unsaved.clear ();
+	counts.fill (0);
+	for (auto & i : checksums)
+	{
+		i.clear ();
+	}
+	checksums_changed.reset ();
+	checksums_saved.reset ();
+	checksums_unsaved.reset ();
+	canaries.clear ();
+}
@@ -2,31 +2,355 @@
 
 #include <mol/common.hpp>
 
+#include <chrono>
+#include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace mol
 {
 class block_store;
 class stat;
 
+class signature_check
+{
+public:
+	mol::block_hash message;
+	mol::public_key key;
+	mol::signature signature;
+	// Set to 1 by signature_checker::verify when the signature is valid
+	int valid;
+};
+/**
+ * Verifies batches of ed25519 signatures across a pool of worker threads
+ */
+class signature_checker
+{
+public:
+	signature_checker (unsigned);
+	~signature_checker ();
+	// Verify every entry, blocking until the whole batch is done
+	void verify (std::vector<mol::signature_check> &);
+	void stop ();
+	// Signatures handed to a worker per ed25519 batch call
+	static size_t constexpr batch_size = 64;
+
+private:
+	void run ();
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::function<void ()>> tasks;
+	bool stopped;
+	std::vector<std::thread> threads;
+};
+
+/**
+ * In-memory copy of the representation table.
+ * Readers take an immutable snapshot without locking. Writers publish a new snapshot holding a small overlay of changed
+ * weights on top of a shared base, the base is rebuilt once the overlay grows past overlay_max.
+ */
+class rep_weights
+{
+public:
+	rep_weights ();
+	mol::uint128_t get (mol::account const &) const;
+	// Every representative with its weight, ordered by account
+	std::vector<std::pair<mol::account, mol::uint128_t>> list () const;
+	// Replace the weights of the given representatives
+	void put (std::unordered_map<mol::account, mol::uint128_t> const &);
+	static size_t constexpr overlay_max = 4096;
+
+private:
+	using weights_t = std::unordered_map<mol::account, mol::uint128_t>;
+	class snapshot
+	{
+	public:
+		std::shared_ptr<weights_t const> base;
+		weights_t overlay;
+	};
+	std::shared_ptr<snapshot const> current;
+	std::mutex writer_mutex;
+};
+/**
+ * Live per-type block counts, loaded from the store once and kept current by the write transactions that commit
+ */
+class block_counters
+{
+public:
+	block_counters ();
+	void load (mol::block_counts const &);
+	void add (mol::block_type, uint64_t);
+	void subtract (mol::block_type, uint64_t);
+	mol::block_counts get () const;
+	uint64_t sum () const;
+
+private:
+	std::array<std::atomic<uint64_t>, static_cast<size_t> (mol::block_type::astate) + 1> counts;
+};
+/**
+ * What a block did to its chain, decided when the block was processed
+ */
+enum class block_subtype : uint8_t
+{
+	unknown = 0,
+	send = 1,
+	receive = 2,
+	open = 3,
+	change = 4,
+	// Creation of a new asset by an astate block
+	issue = 5
+};
+/**
+ * Facts about a block known once it is processed, stored next to it so readers don't walk the chain
+ */
+class block_sideband
+{
+public:
+	block_sideband ();
+	block_sideband (uint64_t, mol::account const &, mol::amount const &, mol::block_subtype, uint64_t);
+	void serialize (mol::stream &) const;
+	bool deserialize (mol::stream &);
+	// Position in the account chain, or in the asset chain for astate blocks, starting at 1
+	uint64_t height;
+	mol::account account;
+	// Balance after this block
+	mol::amount balance;
+	mol::block_subtype subtype;
+	// Local time the block was processed, zero for blocks stored before sidebands existed
+	uint64_t timestamp;
+	static size_t constexpr size = sizeof (uint64_t) + sizeof (mol::account) + sizeof (mol::amount) + sizeof (uint8_t) + sizeof (uint64_t);
+};
+/**
+ * Aggregate of the pending entries of one account
+ */
+class pending_summary
+{
+public:
+	pending_summary ();
+	void serialize (mol::stream &) const;
+	bool deserialize (mol::stream &);
+	void add (mol::uint128_t const &);
+	void remove (mol::uint128_t const &);
+	uint64_t count;
+	mol::amount total;
+	// Largest single pending amount, exact while max_count > 0 and otherwise only an upper bound
+	mol::amount max;
+	// Number of pending entries whose amount equals max
+	uint64_t max_count;
+};
+/**
+ * Aggregate state of one asset across all of its accounts
+ */
+class asset_supply
+{
+public:
+	asset_supply ();
+	void serialize (mol::stream &) const;
+	bool deserialize (mol::stream &);
+	// Sum of all asset account balances
+	mol::amount total;
+	// Asset accounts with a non-zero balance
+	uint64_t holders;
+	// Sent but not yet received
+	mol::amount pending;
+	// Last time a block of this asset was processed or rolled back
+	uint64_t modified;
+};
+/**
+ * Account, asset and asset account state needed to validate an astate block, read together
+ */
+class asset_account_state
+{
+public:
+	asset_account_state ();
+	bool account_exists;
+	mol::account_info account_info;
+	bool asset_exists;
+	bool asset_account_exists;
+	mol::asset_account_info asset_account_info;
+};
+/**
+ * Cumulative count and time of each step of astate block processing
+ */
+class astate_timing
+{
+public:
+	enum class step : uint8_t
+	{
+		signature,
+		lookup,
+		previous,
+		source,
+		write
+	};
+	astate_timing ();
+	void add (mol::astate_timing::step, std::chrono::steady_clock::duration const &);
+	uint64_t count (mol::astate_timing::step) const;
+	uint64_t nanoseconds (mol::astate_timing::step) const;
+	static char const * name (mol::astate_timing::step);
+	static size_t constexpr steps = static_cast<size_t> (mol::astate_timing::step::write) + 1;
+
+private:
+	std::array<std::atomic<uint64_t>, steps> counts;
+	std::array<std::atomic<uint64_t>, steps> times;
+};
+/**
+ * Rolling XOR of the account heads, kept per bucket of accounts sharing the top byte of their number.
+ * The checksum of the whole ledger is the XOR of all buckets.
+ */
+class ledger_checksums
+{
+public:
+	static size_t constexpr buckets = 256;
+	ledger_checksums ();
+	// XOR of buckets first_a through last_a
+	mol::checksum get (size_t, size_t) const;
+	// Bucket values read from the store, missing buckets are written by the next write transaction that changes the ledger
+	void load (std::array<mol::checksum, buckets> const &, std::bitset<buckets> const &);
+	// XOR in the changed buckets of a committed write transaction, given the buckets it wrote to the store and those it left stale
+	void apply (std::array<mol::checksum, buckets> const &, std::bitset<buckets> const &, std::bitset<buckets> const &, std::bitset<buckets> const &);
+	// Buckets whose stored value is stale
+	std::bitset<buckets> unsaved_buckets () const;
+	static size_t bucket (mol::account const &);
+
+private:
+	mutable std::mutex mutex;
+	std::array<mol::checksum, buckets> values;
+	std::bitset<buckets> unsaved;
+};
+/**
+ * Changes a write transaction made to the ledger state kept in memory, published by ledger::committed once the transaction commits
+ */
+class ledger_changes
+{
+public:
+	ledger_changes ();
+	void clear ();
+	// Net weight changes, wrapping arithmetic encodes decreases
+	std::unordered_map<mol::account, mol::uint128_t> weights;
+	// Representatives whose weight changed since it was last written to the store
+	std::unordered_set<mol::account> weights_unsaved;
+	// Net block count changes by type, wrapping arithmetic encodes decreases
+	std::array<uint64_t, static_cast<size_t> (mol::block_type::astate) + 1> counts;
+	std::array<mol::checksum, mol::ledger_checksums::buckets> checksums;
+	std::bitset<mol::ledger_checksums::buckets> checksums_changed;
+	// Checksum buckets written to the store by the transaction, and those changed since they were last written
+	std::bitset<mol::ledger_checksums::buckets> checksums_saved;
+	std::bitset<mol::ledger_checksums::buckets> checksums_unsaved;
+	// Canary blocks added or removed
+	std::unordered_map<mol::block_hash, bool> canaries;
+};
 class shared_ptr_block_hash
 {
 public:
 	size_t operator() (std::shared_ptr<mol::block> const &) const;
 	bool operator() (std::shared_ptr<mol::block> const &, std::shared_ptr<mol::block> const &) const;
 };
-using tally_t = std::map<mol::uint128_t, std::shared_ptr<mol::block>, std::greater<mol::uint128_t>>;
+// Vote totals with their blocks, ordered greatest to least, candidates with equal totals each keep their entry
+using tally_t = std::multimap<mol::uint128_t, std::shared_ptr<mol::block>, std::greater<mol::uint128_t>>;
+class ledger;
+class transaction;
+/**
+ * Write transaction that publishes the changes made through it to the ledger's in-memory state once it has committed
+ */
+class ledger_transaction
+{
+public:
+	ledger_transaction (mol::ledger &);
+	// Commits, then calls ledger::committed
+	~ledger_transaction ();
+	operator MDB_txn * () const;
+	mol::ledger & ledger;
+	MDB_txn * handle;
+
+private:
+	std::unique_ptr<mol::transaction> transaction;
+};
+/**
+ * Running vote totals for the candidates of one election.
+ * Each vote moves a representative's weight from its previous choice to its new one, so totals and the leader stay
+ * current without re-tallying every vote. Candidates with equal totals are kept apart.
+ * An election owns one, calls vote () once for each representative vote that changes and checks have_quorum when
+ * deciding whether to confirm.
+ */
+class vote_tally
+{
+public:
+	vote_tally (mol::ledger &);
+	// Record rep_a voting for block_a, replacing any earlier vote of that representative
+	void vote (MDB_txn *, mol::account const &, std::shared_ptr<mol::block>);
+	// Leading candidate with its total, a null block if there are no votes
+	std::pair<mol::uint128_t, std::shared_ptr<mol::block>> winner () const;
+	// Whether the leader is ahead of the runner-up by at least delta_a
+	bool have_quorum (mol::uint128_t const &) const;
+	mol::uint128_t total (mol::block_hash const &) const;
+	mol::tally_t tally () const;
+	// Number of representatives voting
+	size_t size () const;
+
+private:
+	class candidate
+	{
+	public:
+		std::shared_ptr<mol::block> block;
+		mol::uint128_t total;
+	};
+	class vote_entry
+	{
+	public:
+		std::shared_ptr<mol::block> block;
+		mol::block_hash hash;
+		mol::uint128_t weight;
+	};
+	void move (mol::block_hash const &, mol::uint128_t const &, bool);
+	mol::ledger & ledger;
+	std::unordered_map<mol::block_hash, candidate> candidates;
+	// Totals ordered greatest first, ties broken by hash
+	std::set<std::pair<mol::uint128_t, mol::block_hash>, std::greater<std::pair<mol::uint128_t, mol::block_hash>>> order;
+	std::unordered_map<mol::account, vote_entry> votes;
+};
 class ledger
 {
 public:
+	// Opens its own write transaction to create the ledger tables, so it must not run on a thread holding one
 	ledger (mol::block_store &, mol::stat &, mol::block_hash const & = 0, mol::block_hash const & = 0);
+	// Creates the ledger tables in the caller's write transaction
+	ledger (mol::block_store &, mol::stat &, MDB_txn *, mol::block_hash const & = 0, mol::block_hash const & = 0);
+	// One-shot tallies of every vote, for callers that don't keep a vote_tally of their own
 	std::pair<mol::uint128_t, std::shared_ptr<mol::block>> winner (MDB_txn *, mol::votes const & votes_a);
-	// Map of weight -> associated block, ordered greatest to least
 	mol::tally_t tally (MDB_txn *, mol::votes const &);
 	mol::account account (MDB_txn *, mol::block_hash const &);
 	mol::uint128_t amount (MDB_txn *, mol::block_hash const &);
 	mol::uint128_t balance (MDB_txn *, mol::block_hash const &);
 	mol::uint128_t account_balance (MDB_txn *, mol::account const &);
 	mol::uint128_t account_pending (MDB_txn *, mol::account const &);
+	// Returns true if the account has nothing pending
+	bool pending_summary_get (MDB_txn *, mol::account const &, mol::pending_summary &);
+	mol::uint128_t pending_max (MDB_txn *, mol::account const &);
+	// Pending table writes, keeping the per-account summaries current. Entries sent by astate blocks name their asset
+	// and are also kept in the asset pending index.
+	void pending_put (MDB_txn *, mol::pending_key const &, mol::pending_info const &, mol::asset const & = mol::asset (0));
+	void pending_del (MDB_txn *, mol::pending_key const &, mol::asset const & = mol::asset (0));
+	// Reads the account, the asset and the account's asset account, checking the asset only if the account doesn't hold it
+	mol::asset_account_state asset_account_state (MDB_txn *, mol::account const &, mol::asset const &);
+	// Returns true if no block of the asset was ever processed
+	bool asset_supply_get (MDB_txn *, mol::asset const &, mol::asset_supply &);
+	// Record an asset account balance changing from old to new while the asset's pending total moves by delta, wrapping arithmetic encodes decreases
+	void asset_supply_update (MDB_txn *, mol::asset const &, mol::uint128_t const &, mol::uint128_t const &, mol::uint128_t const &);
+	// Visit the pending entries of one asset for an account in hash order, until the action returns false
+	void asset_pending_for_each (MDB_txn *, mol::account const &, mol::asset const &, std::function<bool(mol::block_hash const &, mol::pending_info const &)> const &);
+	// Weights, block counts, checksums and canaries are served from memory. They are the committed values, plus the pending
+	// changes when read in the write transaction that made them.
 	mol::uint128_t weight (MDB_txn *, mol::account const &);
+	// Number of blocks in the ledger by type
+	mol::block_counts block_count (MDB_txn *);
 	std::unique_ptr<mol::block> successor (MDB_txn *, mol::block_hash const &);
 	std::unique_ptr<mol::block> forked_block (MDB_txn *, mol::block const &);
 	mol::block_hash latest (MDB_txn *, mol::account const &);
@@ -39,11 +363,50 @@ public:
 	bool is_send (MDB_txn *, mol::state_block const &);
 	mol::block_hash block_destination (MDB_txn *, mol::block const &);
 	mol::block_hash block_source (MDB_txn *, mol::block const &);
+	// Check signatures of a batch of blocks ahead of processing, process trusts the ones marked valid
+	void verify_signatures (MDB_txn *, std::vector<mol::block const *> const &);
 	mol::process_return process (MDB_txn *, mol::block const &);
+	// Process blocks in order, a block that gaps on another block of the batch is retried once that block is processed.
+	// Results are in input order.
+	std::vector<mol::process_return> process_batch (MDB_txn *, std::vector<mol::block const *> const &);
+	void prefetch (MDB_txn *, std::vector<mol::block const *> const &, std::unordered_map<mol::block_hash, bool> &);
+	// Remove a block and every block depending on it, planned up front and undone newest first
 	void rollback (MDB_txn *, mol::block_hash const &);
+	// Returns true if the block has no sideband, blocks are backfilled when the sideband table is created but the genesis
+	// block is stored after that
+	bool sideband_get (MDB_txn *, mol::block_hash const &, mol::block_sideband &);
+	void sideband_put (MDB_txn *, mol::block_hash const &, mol::block_sideband const &);
+	void sideband_del (MDB_txn *, mol::block_hash const &);
+	// Index of chain heights, keyed by account, asset and height. The native chain of an account uses a zero asset.
+	void height_put (MDB_txn *, mol::account const &, mol::asset const &, uint64_t, mol::block_hash const &);
+	void height_del (MDB_txn *, mol::account const &, mol::asset const &, uint64_t);
+	// Block at the given height of the chain containing head, returns true if that height isn't indexed
+	bool block_at_height (MDB_txn *, mol::block_hash const &, uint64_t, mol::block_hash &);
+	// Assets the account has an indexed asset chain for
+	std::vector<mol::asset> account_assets (MDB_txn *, mol::account const &);
+	// Adjust the weight of the representative named by the given block, written to the representation table by representation_flush
+	void representation_add (MDB_txn *, mol::block_hash const &, mol::uint128_t const &);
+	void representation_flush (MDB_txn *);
+	// Representation table contents, ordered by account
+	std::vector<std::pair<mol::account, mol::uint128_t>> representation_list (MDB_txn *);
+	// Weights and block counts read from the store, as of the transaction's snapshot rather than the latest commit. For
+	// readers that keep a read transaction open while other transactions commit.
+	mol::uint128_t weight_stored (MDB_txn *, mol::account const &);
+	mol::block_counts block_count_stored (MDB_txn *);
+	std::vector<std::pair<mol::account, mol::uint128_t>> representation_list_stored (MDB_txn *);
 	void change_latest (MDB_txn *, mol::account const &, mol::block_hash const &, mol::account const &, mol::uint128_union const &, uint64_t, bool = false);
-	void checksum_update (MDB_txn *, mol::block_hash const &);
+	// XOR a head in or out of the checksum of the account's bucket, written to the store by checksum_flush.
+	// Changes left unflushed when the transaction commits are written by the next flush.
+	void checksum_update (MDB_txn *, mol::account const &, mol::block_hash const &);
+	void checksum_flush (MDB_txn *);
+	// XOR of the account heads from begin through end. Checksums are only kept per 1/256 of the keyspace, so a range must
+	// cover whole buckets: begin is zero past its top byte and end is all ones past its top byte. The full account range
+	// gives the checksum of the whole ledger.
 	mol::checksum checksum (MDB_txn *, mol::account const &, mol::account const &);
+	// Publish the in-memory changes of a write transaction, called by its owner right after the transaction commits.
+	// mol::ledger_transaction calls it, other owners of a write transaction passed to process, process_batch, rollback or
+	// change_latest must. The next write transaction that changes the ledger waits for it.
+	void committed (MDB_txn *);
 	void dump_account_chain (mol::account const &);
 	bool state_block_parsing_enabled (MDB_txn *);
 	bool state_block_generation_enabled (MDB_txn *);
@@ -55,5 +418,50 @@ public:
 	std::atomic<bool> check_bootstrap_weights;
 	mol::block_hash state_block_parse_canary;
 	mol::block_hash state_block_generate_canary;
+	// Whether the canary blocks are in the committed ledger, set once the transaction processing them is committed and cleared
+	// once a rollback of them is
+	std::atomic<bool> state_block_parse_canary_exists;
+	std::atomic<bool> state_block_generate_canary_exists;
+	mol::signature_checker signature_checker;
+	// block_hash -> block_sideband
+	MDB_dbi sidebands;
+	// account, asset, big endian height -> block_hash
+	MDB_dbi heights;
+	// account -> pending_summary
+	MDB_dbi pending_summaries;
+	// account, asset, send block hash -> pending_info
+	MDB_dbi asset_pendings;
+	// asset -> asset_supply
+	MDB_dbi asset_supplies;
+	mol::astate_timing astate_timing;
+
+private:
+	void canary_update (MDB_txn *, mol::block_hash const &, bool);
+	bool canary_exists (MDB_txn *, mol::block_hash const &, std::atomic<bool> const &);
+	void pending_summary_put (MDB_txn *, mol::account const &, mol::pending_summary const &);
+	void pending_summaries_build (MDB_txn *);
+	void sidebands_build (MDB_txn *);
+	void asset_pendings_build (MDB_txn *);
+	void asset_pending_put (MDB_txn *, mol::pending_key const &, mol::pending_info const &, mol::asset const &);
+	void asset_supply_put (MDB_txn *, mol::asset const &, mol::asset_supply const &);
+	void asset_supplies_build (MDB_txn *);
+	// Weights, block counts and checksums of the committed ledger, loaded by state_current
+	mol::rep_weights rep_weights;
+	mol::block_counters block_counters;
+	mol::ledger_checksums checksums;
+	// Load the in-memory state from transaction_a on first use
+	void state_current (MDB_txn *);
+	// The caller holds changes_mutex
+	void state_load (MDB_txn *);
+	std::atomic<bool> state_loaded;
+	// Changes of the write transaction changes_transaction. Only its owner's thread touches them until committed publishes them.
+	mol::ledger_changes changes;
+	// Write transaction with unpublished changes, null if there is none
+	std::atomic<MDB_txn *> changes_transaction;
+	std::mutex changes_mutex;
+	std::condition_variable changes_condition;
+	// Start collecting the changes of transaction_a unless it already is, once the previous transaction's are published
+	void changes_open (MDB_txn *);
+	void changes_publish ();
 };
 };
@@ -2,6 +2,12 @@
 
 #include <boost/endian/conversion.hpp>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
 /** Compare blocks, first by type, then content. This is an optimization over dynamic_cast, which is very slow on some platforms. */
 namespace
 {
@@ -9,8 +15,475 @@ template <typename T>
 bool blocks_equal (T const & first, mol::block const & second)
 {
 	static_assert (std::is_base_of<mol::block, T>::value, "Input parameter is not a block type");
-	return (first.type () == second.type ()) && (static_cast<T const &> (second)) == first;
+	auto result (first.type () == second.type ());
+	if (result)
+	{
+		// Differing memoized digests mean differing hashables, skip the field by field comparison
+		mol::block_hash first_hash;
+		mol::block_hash second_hash;
+		if (!first.hash_cached (first_hash) && !second.hash_cached (second_hash))
+		{
+			result = first_hash == second_hash;
+		}
+		result = result && (static_cast<T const &> (second)) == first;
+	}
+	return result;
+}
+
+/**
+ * Writes a flat object of string values byte for byte as boost::property_tree::write_json would, without building a ptree.
+ * Hex and decimal fields are encoded straight into the output.
+ */
+class json_block_writer
+{
+public:
+	json_block_writer (std::string & string_a) :
+	string (string_a),
+	first (true)
+	{
+		string.clear ();
+		string.reserve (1024);
+		string.append ("{\n", 2);
+	}
+	void put (char const * key_a, std::string const & value_a)
+	{
+		key (key_a);
+		mol::json_escape (string, value_a);
+		string.push_back ('"');
+	}
+	// Uppercase hex of a big endian number, as produced by encode_hex
+	template <size_t N>
+	void put_hex (char const * key_a, std::array<uint8_t, N> const & bytes_a)
+	{
+		key (key_a);
+		static char const * hex ("0123456789ABCDEF");
+		auto offset (string.size ());
+		string.resize (offset + 2 * N);
+		for (auto i : bytes_a)
+		{
+			string[offset++] = hex[i >> 4];
+			string[offset++] = hex[i & 0xf];
+		}
+		string.push_back ('"');
+	}
+	// Lowercase zero padded hex, as produced by mol::to_string_hex
+	void put_work (char const * key_a, uint64_t work_a)
+	{
+		key (key_a);
+		static char const * hex ("0123456789abcdef");
+		char buffer[16];
+		for (auto i (15); i >= 0; --i, work_a >>= 4)
+		{
+			buffer[i] = hex[work_a & 0xf];
+		}
+		string.append (buffer, sizeof (buffer));
+		string.push_back ('"');
+	}
+	// Decimal without leading zeros, as produced by uint128_union::to_string_dec
+	void put_dec (char const * key_a, mol::uint128_union const & value_a)
+	{
+		key (key_a);
+		// Split into base 10^19 digits so each one fits a uint64_t
+		uint64_t constexpr base (10000000000000000000ULL);
+		auto value (value_a.number ());
+		uint64_t digits[3];
+		auto count (0);
+		do
+		{
+			digits[count++] = static_cast<uint64_t> (value % base);
+			value /= base;
+		} while (!value.is_zero ());
+		char buffer[20];
+		for (auto i (count - 1); i >= 0; --i)
+		{
+			auto end (buffer + sizeof (buffer));
+			auto position (end);
+			auto digit (digits[i]);
+			do
+			{
+				*--position = static_cast<char> ('0' + digit % 10);
+				digit /= 10;
+			} while (digit != 0);
+			if (i != count - 1)
+			{
+				// Inner digits keep their leading zeros
+				while (end - position < 19)
+				{
+					*--position = '0';
+				}
+			}
+			string.append (position, end);
+		}
+		string.push_back ('"');
+	}
+	void finish ()
+	{
+		string.append ("\n}\n", 3);
+	}
+
+private:
+	void key (char const * key_a)
+	{
+		if (!first)
+		{
+			string.append (",\n", 2);
+		}
+		first = false;
+		string.append ("    \"", 5);
+		string.append (key_a);
+		string.append ("\": \"", 4);
+	}
+	std::string & string;
+	bool first;
+};
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+/** Largest hashables message of any block type, preamble included */
+size_t constexpr hashables_max = 256;
+
+class hashables_writer
+{
+public:
+	hashables_writer (uint8_t * buffer_a) :
+	buffer (buffer_a),
+	size (0)
+	{
+	}
+	template <typename T>
+	void append (T const & value_a)
+	{
+		assert (size + value_a.bytes.size () <= hashables_max);
+		std::copy (value_a.bytes.begin (), value_a.bytes.end (), buffer + size);
+		size += value_a.bytes.size ();
+	}
+	uint8_t * buffer;
+	size_t size;
+};
+
+/** Write the exact byte sequence block::hash feeds to blake2b, returns zero for unknown types */
+size_t hashables_bytes (mol::block const & block_a, uint8_t * buffer_a)
+{
+	hashables_writer writer (buffer_a);
+	switch (block_a.type ())
+	{
+		case mol::block_type::send:
+		{
+			auto const & hashables (static_cast<mol::send_block const &> (block_a).hashables);
+			writer.append (hashables.previous);
+			writer.append (hashables.destination);
+			writer.append (hashables.balance);
+			break;
+		}
+		case mol::block_type::receive:
+		{
+			auto const & hashables (static_cast<mol::receive_block const &> (block_a).hashables);
+			writer.append (hashables.previous);
+			writer.append (hashables.source);
+			break;
+		}
+		case mol::block_type::open:
+		{
+			auto const & hashables (static_cast<mol::open_block const &> (block_a).hashables);
+			writer.append (hashables.source);
+			writer.append (hashables.representative);
+			writer.append (hashables.account);
+			break;
+		}
+		case mol::block_type::change:
+		{
+			auto const & hashables (static_cast<mol::change_block const &> (block_a).hashables);
+			writer.append (hashables.previous);
+			writer.append (hashables.representative);
+			break;
+		}
+		case mol::block_type::state:
+		{
+			auto const & hashables (static_cast<mol::state_block const &> (block_a).hashables);
+			writer.append (mol::uint256_union (static_cast<uint64_t> (mol::block_type::state)));
+			writer.append (hashables.account);
+			writer.append (hashables.previous);
+			writer.append (hashables.representative);
+			writer.append (hashables.balance);
+			writer.append (hashables.link);
+			break;
+		}
+		case mol::block_type::astate:
+		{
+			auto const & hashables (static_cast<mol::astate_block const &> (block_a).hashables);
+			writer.append (mol::uint256_union (static_cast<uint64_t> (mol::block_type::astate)));
+			writer.append (hashables.account);
+			writer.append (hashables.previous);
+			writer.append (hashables.representative);
+			writer.append (hashables.balance);
+			writer.append (hashables.link);
+			writer.append (hashables.asset);
+			writer.append (hashables.genesis_account);
+			break;
+		}
+		default:
+			break;
+	}
+	return writer.size;
+}
+
+uint64_t const blake2b_iv[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+uint8_t const blake2b_sigma[12][16] = {
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+	{ 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+	{ 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+	{ 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+	{ 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+	{ 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+	{ 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+	{ 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+	{ 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 },
+	{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+	{ 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 }
+};
+
+#if defined(__AVX2__)
+/** Four independent blake2b states, one per 64-bit lane */
+class blake2b_lanes
+{
+public:
+	using vector = __m256i;
+	static size_t constexpr count = 4;
+	static vector load (uint64_t const * words_a)
+	{
+		return _mm256_loadu_si256 (reinterpret_cast<vector const *> (words_a));
+	}
+	static void store (uint64_t * words_a, vector value_a)
+	{
+		_mm256_storeu_si256 (reinterpret_cast<vector *> (words_a), value_a);
+	}
+	static vector set1 (uint64_t value_a)
+	{
+		return _mm256_set1_epi64x (static_cast<long long> (value_a));
+	}
+	static vector add (vector a, vector b)
+	{
+		return _mm256_add_epi64 (a, b);
+	}
+	static vector xor_ (vector a, vector b)
+	{
+		return _mm256_xor_si256 (a, b);
+	}
+	static vector rotr32 (vector a)
+	{
+		return _mm256_shuffle_epi32 (a, _MM_SHUFFLE (2, 3, 0, 1));
+	}
+	static vector rotr24 (vector a)
+	{
+		return _mm256_shuffle_epi8 (a, _mm256_setr_epi8 (3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+	}
+	static vector rotr16 (vector a)
+	{
+		return _mm256_shuffle_epi8 (a, _mm256_setr_epi8 (2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+	}
+	static vector rotr63 (vector a)
+	{
+		return _mm256_xor_si256 (_mm256_srli_epi64 (a, 63), _mm256_add_epi64 (a, a));
+	}
+};
+#else
+/** Two independent blake2b states, one per 64-bit lane */
+class blake2b_lanes
+{
+public:
+	using vector = __m128i;
+	static size_t constexpr count = 2;
+	static vector load (uint64_t const * words_a)
+	{
+		return _mm_loadu_si128 (reinterpret_cast<vector const *> (words_a));
+	}
+	static void store (uint64_t * words_a, vector value_a)
+	{
+		_mm_storeu_si128 (reinterpret_cast<vector *> (words_a), value_a);
+	}
+	static vector set1 (uint64_t value_a)
+	{
+		return _mm_set1_epi64x (static_cast<long long> (value_a));
+	}
+	static vector add (vector a, vector b)
+	{
+		return _mm_add_epi64 (a, b);
+	}
+	static vector xor_ (vector a, vector b)
+	{
+		return _mm_xor_si128 (a, b);
+	}
+	static vector rotr32 (vector a)
+	{
+		return _mm_shuffle_epi32 (a, _MM_SHUFFLE (2, 3, 0, 1));
+	}
+	static vector rotr24 (vector a)
+	{
+		return _mm_shuffle_epi8 (a, _mm_setr_epi8 (3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+	}
+	static vector rotr16 (vector a)
+	{
+		return _mm_shuffle_epi8 (a, _mm_setr_epi8 (2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+	}
+	static vector rotr63 (vector a)
+	{
+		return _mm_xor_si128 (_mm_srli_epi64 (a, 63), _mm_add_epi64 (a, a));
+	}
+};
+#endif
+
+inline void blake2b_g (blake2b_lanes::vector & a, blake2b_lanes::vector & b, blake2b_lanes::vector & c, blake2b_lanes::vector & d, blake2b_lanes::vector const & x, blake2b_lanes::vector const & y)
+{
+	a = blake2b_lanes::add (blake2b_lanes::add (a, b), x);
+	d = blake2b_lanes::rotr32 (blake2b_lanes::xor_ (d, a));
+	c = blake2b_lanes::add (c, d);
+	b = blake2b_lanes::rotr24 (blake2b_lanes::xor_ (b, c));
+	a = blake2b_lanes::add (blake2b_lanes::add (a, b), y);
+	d = blake2b_lanes::rotr16 (blake2b_lanes::xor_ (d, a));
+	c = blake2b_lanes::add (c, d);
+	b = blake2b_lanes::rotr63 (blake2b_lanes::xor_ (b, c));
+}
+
+uint64_t load_le64 (uint8_t const * bytes_a)
+{
+	uint64_t result (0);
+	for (auto i (0); i < 8; ++i)
+	{
+		result |= static_cast<uint64_t> (bytes_a[i]) << (8 * i);
+	}
+	return result;
+}
+
+/**
+ * Unkeyed 32 byte blake2b of blake2b_lanes::count messages which all have length size_a.
+ * Every lane runs the same number of compressions so they advance in lockstep.
+ */
+void blake2b_lockstep (uint8_t const * const * messages_a, size_t size_a, mol::block_hash * results_a)
+{
+	using lanes = blake2b_lanes;
+	size_t constexpr block_bytes = 128;
+	lanes::vector h[8];
+	for (auto i (0); i < 8; ++i)
+	{
+		h[i] = lanes::set1 (blake2b_iv[i]);
+	}
+	// Parameter block: digest length, no key, fanout 1, depth 1
+	h[0] = lanes::set1 (blake2b_iv[0] ^ 0x01010000ULL ^ sizeof (mol::block_hash));
+	auto blocks (std::max<size_t> (1, (size_a + block_bytes - 1) / block_bytes));
+	for (size_t block (0); block < blocks; ++block)
+	{
+		auto offset (block * block_bytes);
+		auto length (std::min (block_bytes, size_a - offset));
+		lanes::vector m[16];
+		for (auto word (0); word < 16; ++word)
+		{
+			uint64_t words[lanes::count];
+			for (size_t lane (0); lane < lanes::count; ++lane)
+			{
+				uint8_t padded[8] = { 0 };
+				size_t begin (word * 8);
+				if (begin < length)
+				{
+					std::copy (messages_a[lane] + offset + begin, messages_a[lane] + offset + std::min (begin + 8, length), padded);
+				}
+				words[lane] = load_le64 (padded);
+			}
+			m[word] = lanes::load (words);
+		}
+		auto counter (static_cast<uint64_t> (offset + length));
+		auto last (block + 1 == blocks);
+		lanes::vector v[16];
+		for (auto i (0); i < 8; ++i)
+		{
+			v[i] = h[i];
+			v[i + 8] = lanes::set1 (blake2b_iv[i]);
+		}
+		v[12] = lanes::xor_ (v[12], lanes::set1 (counter));
+		if (last)
+		{
+			v[14] = lanes::xor_ (v[14], lanes::set1 (~0ULL));
+		}
+		for (auto round (0); round < 12; ++round)
+		{
+			auto const * s (blake2b_sigma[round]);
+			blake2b_g (v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+			blake2b_g (v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+			blake2b_g (v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+			blake2b_g (v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+			blake2b_g (v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+			blake2b_g (v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+			blake2b_g (v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+			blake2b_g (v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+		}
+		for (auto i (0); i < 8; ++i)
+		{
+			h[i] = lanes::xor_ (h[i], lanes::xor_ (v[i], v[i + 8]));
+		}
+	}
+	for (auto i (0); i < 4; ++i)
+	{
+		uint64_t words[lanes::count];
+		lanes::store (words, h[i]);
+		for (size_t lane (0); lane < lanes::count; ++lane)
+		{
+			for (auto byte (0); byte < 8; ++byte)
+			{
+				results_a[lane].bytes[i * 8 + byte] = static_cast<uint8_t> (words[lane] >> (8 * byte));
+			}
+		}
+	}
 }
+#endif
+}
+
+void mol::json_escape (std::string & string_a, std::string const & value_a)
+{
+	// Matches the escaping of boost::property_tree::json_parser::create_escapes
+	static char const * hex ("0123456789ABCDEF");
+	for (auto i : value_a)
+	{
+		auto c (static_cast<unsigned char> (i));
+		if (c == 0x20 || c == 0x21 || (c >= 0x23 && c <= 0x2e) || (c >= 0x30 && c <= 0x5b) || c >= 0x5d)
+		{
+			string_a.push_back (i);
+		}
+		else
+		{
+			string_a.push_back ('\\');
+			switch (i)
+			{
+				case '\b':
+					string_a.push_back ('b');
+					break;
+				case '\f':
+					string_a.push_back ('f');
+					break;
+				case '\n':
+					string_a.push_back ('n');
+					break;
+				case '\r':
+					string_a.push_back ('r');
+					break;
+				case '\t':
+					string_a.push_back ('t');
+					break;
+				case '/':
+				case '"':
+				case '\\':
+					string_a.push_back (i);
+					break;
+				default:
+					string_a.append ("u00", 3);
+					string_a.push_back (hex[c >> 4]);
+					string_a.push_back (hex[c & 0xf]);
+					break;
+			}
+		}
+	}
 }
 
 std::string mol::to_string_hex (uint64_t value_a)
@@ -57,18 +530,159 @@ std::string mol::block::to_json ()
 	return result;
 }
 
+mol::block::block () :
+cached_state (cache_state::empty),
+verified (false)
+{
+}
+
+mol::block::block (mol::block const &) :
+cached_state (cache_state::empty),
+verified (false)
+{
+}
+
+mol::block & mol::block::operator= (mol::block const &)
+{
+	hash_invalidate ();
+	return *this;
+}
+
 mol::block_hash mol::block::hash () const
 {
 	mol::uint256_union result;
-	blake2b_state hash_l;
-	auto status (blake2b_init (&hash_l, sizeof (result.bytes)));
-	assert (status == 0);
-	hash (hash_l);
-	status = blake2b_final (&hash_l, result.bytes.data (), sizeof (result.bytes));
-	assert (status == 0);
+	if (hash_cached (result))
+	{
+		blake2b_state hash_l;
+		auto status (blake2b_init (&hash_l, sizeof (result.bytes)));
+		assert (status == 0);
+		hash (hash_l);
+		status = blake2b_final (&hash_l, result.bytes.data (), sizeof (result.bytes));
+		assert (status == 0);
+		hash_store (result);
+	}
+	return result;
+}
+
+void mol::block::hash_invalidate ()
+{
+	cached_state.store (cache_state::empty, std::memory_order_release);
+	signature_verified_clear ();
+}
+
+void mol::block::signature_verified_set (mol::account const & account_a) const
+{
+	verified_account = account_a;
+	verified.store (true, std::memory_order_release);
+}
+
+bool mol::block::signature_verified (mol::account const & account_a) const
+{
+	return verified.load (std::memory_order_acquire) && verified_account == account_a;
+}
+
+void mol::block::signature_verified_clear ()
+{
+	verified.store (false, std::memory_order_release);
+}
+
+bool mol::block::hash_cached (mol::block_hash & hash_a) const
+{
+	auto result (cached_state.load (std::memory_order_acquire) != cache_state::ready);
+	if (!result)
+	{
+		hash_a = cached_hash;
+	}
 	return result;
 }
 
+void mol::block::hash_store (mol::block_hash const & hash_a) const
+{
+	// Only one concurrent reader gets to publish, the others already hold an identical digest
+	uint8_t expected (cache_state::empty);
+	if (cached_state.compare_exchange_strong (expected, cache_state::writing, std::memory_order_acquire))
+	{
+		cached_hash = hash_a;
+		cached_state.store (cache_state::ready, std::memory_order_release);
+	}
+}
+
+void mol::hash_blocks (std::vector<mol::block const *> const & blocks_a, std::vector<mol::block_hash> & hashes_a)
+{
+	hashes_a.resize (blocks_a.size ());
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	// Hashables of a given block type always have the same length so blocks are grouped by type to share lanes
+	std::array<std::vector<size_t>, static_cast<size_t> (mol::block_type::astate) + 1> groups;
+	for (size_t i (0), n (blocks_a.size ()); i < n; ++i)
+	{
+		// Blocks with a memoized digest are answered directly and take no lane
+		if (blocks_a[i]->hash_cached (hashes_a[i]))
+		{
+			auto type (static_cast<size_t> (blocks_a[i]->type ()));
+			if (type < groups.size ())
+			{
+				groups[type].push_back (i);
+			}
+			else
+			{
+				hashes_a[i] = blocks_a[i]->hash ();
+			}
+		}
+	}
+	for (auto const & group : groups)
+	{
+		size_t i (0);
+		for (; i + blake2b_lanes::count <= group.size (); i += blake2b_lanes::count)
+		{
+			std::array<std::array<uint8_t, hashables_max>, blake2b_lanes::count> buffers;
+			std::array<uint8_t const *, blake2b_lanes::count> messages;
+			std::array<mol::block_hash, blake2b_lanes::count> results;
+			size_t size (0);
+			for (size_t lane (0); lane < blake2b_lanes::count; ++lane)
+			{
+				size = hashables_bytes (*blocks_a[group[i + lane]], buffers[lane].data ());
+				messages[lane] = buffers[lane].data ();
+			}
+			if (size != 0)
+			{
+				blake2b_lockstep (messages.data (), size, results.data ());
+				for (size_t lane (0); lane < blake2b_lanes::count; ++lane)
+				{
+					hashes_a[group[i + lane]] = results[lane];
+					blocks_a[group[i + lane]]->hash_store (results[lane]);
+				}
+			}
+			else
+			{
+				for (size_t lane (0); lane < blake2b_lanes::count; ++lane)
+				{
+					hashes_a[group[i + lane]] = blocks_a[group[i + lane]]->hash ();
+				}
+			}
+		}
+		for (; i < group.size (); ++i)
+		{
+			hashes_a[group[i]] = blocks_a[group[i]]->hash ();
+		}
+	}
+#else
+	for (size_t i (0), n (blocks_a.size ()); i < n; ++i)
+	{
+		hashes_a[i] = blocks_a[i]->hash ();
+	}
+#endif
+}
+
+void * mol::send_block::operator new (size_t size_a)
+{
+	return mol::block_pool<mol::send_block>::operator_new (size_a);
+}
+
+void mol::send_block::operator delete (void * block_a, size_t size_a)
+{
+	mol::block_pool<mol::send_block>::operator_delete (block_a, size_a);
+}
+
 void mol::send_block::visit (mol::block_visitor & visitor_a) const
 {
 	visitor_a.send_block (*this);
@@ -153,26 +767,19 @@ void mol::send_block::serialize (mol::stream & stream_a) const
 
 void mol::send_block::serialize_json (std::string & string_a) const
 {
-	boost::property_tree::ptree tree;
-	tree.put ("type", "send");
-	std::string previous;
-	hashables.previous.encode_hex (previous);
-	tree.put ("previous", previous);
-	tree.put ("destination", hashables.destination.to_account ());
-	std::string balance;
-	hashables.balance.encode_hex (balance);
-	tree.put ("balance", balance);
-	std::string signature_l;
-	signature.encode_hex (signature_l);
-	tree.put ("work", mol::to_string_hex (work));
-	tree.put ("signature", signature_l);
-	std::stringstream ostream;
-	boost::property_tree::write_json (ostream, tree);
-	string_a = ostream.str ();
+	json_block_writer writer (string_a);
+	writer.put ("type", "send");
+	writer.put_hex ("previous", hashables.previous.bytes);
+	writer.put ("destination", hashables.destination.to_account ());
+	writer.put_hex ("balance", hashables.balance.bytes);
+	writer.put_work ("work", work);
+	writer.put_hex ("signature", signature.bytes);
+	writer.finish ();
 }
 
 bool mol::send_block::deserialize (mol::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	error = read (stream_a, hashables.previous.bytes);
 	if (!error)
@@ -196,6 +803,7 @@ bool mol::send_block::deserialize (mol::stream & stream_a)
 
 bool mol::send_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
@@ -334,6 +942,7 @@ mol::signature mol::send_block::block_signature () const
 void mol::send_block::signature_set (mol::uint512_union const & signature_a)
 {
 	signature = signature_a;
+	signature_verified_clear ();
 }
 
 mol::open_hashables::open_hashables (mol::block_hash const & source_a, mol::account const & representative_a, mol::account const & account_a) :
@@ -468,22 +1077,19 @@ void mol::open_block::serialize (mol::stream & stream_a) const
 
 void mol::open_block::serialize_json (std::string & string_a) const
 {
-	boost::property_tree::ptree tree;
-	tree.put ("type", "open");
-	tree.put ("source", hashables.source.to_string ());
-	tree.put ("representative", representative ().to_account ());
-	tree.put ("account", hashables.account.to_account ());
-	std::string signature_l;
-	signature.encode_hex (signature_l);
-	tree.put ("work", mol::to_string_hex (work));
-	tree.put ("signature", signature_l);
-	std::stringstream ostream;
-	boost::property_tree::write_json (ostream, tree);
-	string_a = ostream.str ();
+	json_block_writer writer (string_a);
+	writer.put ("type", "open");
+	writer.put_hex ("source", hashables.source.bytes);
+	writer.put ("representative", representative ().to_account ());
+	writer.put ("account", hashables.account.to_account ());
+	writer.put_work ("work", work);
+	writer.put_hex ("signature", signature.bytes);
+	writer.finish ();
 }
 
 bool mol::open_block::deserialize (mol::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (read (stream_a, hashables.source));
 	if (!error)
 	{
@@ -506,6 +1112,7 @@ bool mol::open_block::deserialize (mol::stream & stream_a)
 
 bool mol::open_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
@@ -540,6 +1147,16 @@ bool mol::open_block::deserialize_json (boost::property_tree::ptree const & tree
 	return error;
 }
 
+void * mol::open_block::operator new (size_t size_a)
+{
+	return mol::block_pool<mol::open_block>::operator_new (size_a);
+}
+
+void mol::open_block::operator delete (void * block_a, size_t size_a)
+{
+	mol::block_pool<mol::open_block>::operator_delete (block_a, size_a);
+}
+
 void mol::open_block::visit (mol::block_visitor & visitor_a) const
 {
 	visitor_a.open_block (*this);
@@ -588,6 +1205,7 @@ mol::signature mol::open_block::block_signature () const
 void mol::open_block::signature_set (mol::uint512_union const & signature_a)
 {
 	signature = signature_a;
+	signature_verified_clear ();
 }
 
 mol::change_hashables::change_hashables (mol::block_hash const & previous_a, mol::account const & representative_a) :
@@ -701,21 +1319,18 @@ void mol::change_block::serialize (mol::stream & stream_a) const
 
 void mol::change_block::serialize_json (std::string & string_a) const
 {
-	boost::property_tree::ptree tree;
-	tree.put ("type", "change");
-	tree.put ("previous", hashables.previous.to_string ());
-	tree.put ("representative", representative ().to_account ());
-	tree.put ("work", mol::to_string_hex (work));
-	std::string signature_l;
-	signature.encode_hex (signature_l);
-	tree.put ("signature", signature_l);
-	std::stringstream ostream;
-	boost::property_tree::write_json (ostream, tree);
-	string_a = ostream.str ();
+	json_block_writer writer (string_a);
+	writer.put ("type", "change");
+	writer.put_hex ("previous", hashables.previous.bytes);
+	writer.put ("representative", representative ().to_account ());
+	writer.put_work ("work", work);
+	writer.put_hex ("signature", signature.bytes);
+	writer.finish ();
 }
 
 bool mol::change_block::deserialize (mol::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (read (stream_a, hashables.previous));
 	if (!error)
 	{
@@ -734,6 +1349,7 @@ bool mol::change_block::deserialize (mol::stream & stream_a)
 
 bool mol::change_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
@@ -763,6 +1379,16 @@ bool mol::change_block::deserialize_json (boost::property_tree::ptree const & tr
 	return error;
 }
 
+void * mol::change_block::operator new (size_t size_a)
+{
+	return mol::block_pool<mol::change_block>::operator_new (size_a);
+}
+
+void mol::change_block::operator delete (void * block_a, size_t size_a)
+{
+	mol::block_pool<mol::change_block>::operator_delete (block_a, size_a);
+}
+
 void mol::change_block::visit (mol::block_visitor & visitor_a) const
 {
 	visitor_a.change_block (*this);
@@ -824,6 +1450,7 @@ mol::signature mol::change_block::block_signature () const
 void mol::change_block::signature_set (mol::uint512_union const & signature_a)
 {
 	signature = signature_a;
+	signature_verified_clear ();
 }
 
 mol::state_hashables::state_hashables (mol::account const & account_a, mol::block_hash const & previous_a, mol::account const & representative_a, mol::amount const & balance_a, mol::uint256_union const & link_a) :
@@ -981,25 +1608,22 @@ void mol::state_block::serialize (mol::stream & stream_a) const
 
 void mol::state_block::serialize_json (std::string & string_a) const
 {
-	boost::property_tree::ptree tree;
-	tree.put ("type", "state");
-	tree.put ("account", hashables.account.to_account ());
-	tree.put ("previous", hashables.previous.to_string ());
-	tree.put ("representative", representative ().to_account ());
-	tree.put ("balance", hashables.balance.to_string_dec ());
-	tree.put ("link", hashables.link.to_string ());
-	tree.put ("link_as_account", hashables.link.to_account ());
-	std::string signature_l;
-	signature.encode_hex (signature_l);
-	tree.put ("signature", signature_l);
-	tree.put ("work", mol::to_string_hex (work));
-	std::stringstream ostream;
-	boost::property_tree::write_json (ostream, tree);
-	string_a = ostream.str ();
+	json_block_writer writer (string_a);
+	writer.put ("type", "state");
+	writer.put ("account", hashables.account.to_account ());
+	writer.put_hex ("previous", hashables.previous.bytes);
+	writer.put ("representative", representative ().to_account ());
+	writer.put_dec ("balance", hashables.balance);
+	writer.put_hex ("link", hashables.link.bytes);
+	writer.put ("link_as_account", hashables.link.to_account ());
+	writer.put_hex ("signature", signature.bytes);
+	writer.put_work ("work", work);
+	writer.finish ();
 }
 
 bool mol::state_block::deserialize (mol::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (read (stream_a, hashables.account));
 	if (!error)
 	{
@@ -1031,6 +1655,7 @@ bool mol::state_block::deserialize (mol::stream & stream_a)
 
 bool mol::state_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
@@ -1075,6 +1700,16 @@ bool mol::state_block::deserialize_json (boost::property_tree::ptree const & tre
 	return error;
 }
 
+void * mol::state_block::operator new (size_t size_a)
+{
+	return mol::block_pool<mol::state_block>::operator_new (size_a);
+}
+
+void mol::state_block::operator delete (void * block_a, size_t size_a)
+{
+	mol::block_pool<mol::state_block>::operator_delete (block_a, size_a);
+}
+
 void mol::state_block::visit (mol::block_visitor & visitor_a) const
 {
 	visitor_a.state_block (*this);
@@ -1123,6 +1758,7 @@ mol::signature mol::state_block::block_signature () const
 void mol::state_block::signature_set (mol::uint512_union const & signature_a)
 {
 	signature = signature_a;
+	signature_verified_clear ();
 }
 
 std::unique_ptr<mol::block> mol::deserialize_block_json (boost::property_tree::ptree const & tree_a)
@@ -1176,6 +1812,15 @@ std::unique_ptr<mol::block> mol::deserialize_block_json (boost::property_tree::p
 				result = std::move (obj);
 			}
 		}
+		else if (type == "astate")
+		{
+			bool error;
+			std::unique_ptr<mol::astate_block> obj (new mol::astate_block (error, tree_a));
+			if (!error)
+			{
+				result = std::move (obj);
+			}
+		}
 	}
 	catch (std::runtime_error const &)
 	{
@@ -1183,6 +1828,637 @@ std::unique_ptr<mol::block> mol::deserialize_block_json (boost::property_tree::p
 	return result;
 }
 
+namespace
+{
+/** Block fields understood by block_json_reader */
+enum class block_json_field : uint8_t
+{
+	type,
+	account,
+	previous,
+	representative,
+	balance,
+	link,
+	source,
+	destination,
+	asset,
+	genesis_account,
+	identifier,
+	signature,
+	work,
+	count
+};
+
+/**
+ * Single pass reader for a flat block JSON object.
+ * Values of known fields are unescaped into fixed slots, the first occurrence of a key wins and unknown keys are skipped,
+ * mirroring what ptree lookups see after read_json.
+ */
+class block_json_reader
+{
+public:
+	block_json_reader (std::string const & text_a) :
+	position (text_a.data ()),
+	end (text_a.data () + text_a.size ())
+	{
+		present.fill (false);
+	}
+	// Returns true on malformed JSON
+	bool parse ()
+	{
+		auto error (expect ('{'));
+		if (!error)
+		{
+			whitespace ();
+			if (position != end && *position == '}')
+			{
+				++position;
+			}
+			else
+			{
+				auto done (false);
+				while (!error && !done)
+				{
+					std::string key;
+					error = expect ('"') || string (key);
+					if (!error)
+					{
+						error = expect (':');
+						if (!error)
+						{
+							auto field (lookup (key));
+							auto slot (field != block_json_field::count && !present[static_cast<size_t> (field)] ? &values[static_cast<size_t> (field)] : nullptr);
+							error = value (slot);
+							if (!error && slot != nullptr)
+							{
+								present[static_cast<size_t> (field)] = true;
+							}
+							if (!error)
+							{
+								whitespace ();
+								if (position != end && *position == ',')
+								{
+									++position;
+								}
+								else
+								{
+									error = expect ('}');
+									done = true;
+								}
+							}
+						}
+					}
+				}
+			}
+			if (!error)
+			{
+				whitespace ();
+				error = position != end;
+			}
+		}
+		return error;
+	}
+	// Value of a field, returns true if the field was absent
+	bool get (block_json_field field_a, std::string const *& value_a) const
+	{
+		value_a = &values[static_cast<size_t> (field_a)];
+		return !present[static_cast<size_t> (field_a)];
+	}
+	bool decode (mol::send_block & block_a) const
+	{
+		std::string const * previous_l;
+		std::string const * destination_l;
+		std::string const * balance_l;
+		auto error (get (block_json_field::previous, previous_l) || get (block_json_field::destination, destination_l) || get (block_json_field::balance, balance_l));
+		if (!error)
+		{
+			error = block_a.hashables.previous.decode_hex (*previous_l);
+			if (!error)
+			{
+				error = block_a.hashables.destination.decode_account (*destination_l);
+				if (!error)
+				{
+					error = block_a.hashables.balance.decode_hex (*balance_l);
+					if (!error)
+					{
+						error = signature_work (block_a.signature, block_a.work);
+					}
+				}
+			}
+		}
+		return error;
+	}
+	bool decode (mol::receive_block & block_a) const
+	{
+		std::string const * previous_l;
+		std::string const * source_l;
+		auto error (get (block_json_field::previous, previous_l) || get (block_json_field::source, source_l));
+		if (!error)
+		{
+			error = block_a.hashables.previous.decode_hex (*previous_l);
+			if (!error)
+			{
+				error = block_a.hashables.source.decode_hex (*source_l);
+				if (!error)
+				{
+					error = signature_work (block_a.signature, block_a.work);
+				}
+			}
+		}
+		return error;
+	}
+	bool decode (mol::open_block & block_a) const
+	{
+		std::string const * source_l;
+		std::string const * representative_l;
+		std::string const * account_l;
+		auto error (get (block_json_field::source, source_l) || get (block_json_field::representative, representative_l) || get (block_json_field::account, account_l));
+		if (!error)
+		{
+			error = block_a.hashables.source.decode_hex (*source_l);
+			if (!error)
+			{
+				error = block_a.hashables.representative.decode_account (*representative_l);
+				if (!error)
+				{
+					error = block_a.hashables.account.decode_account (*account_l);
+					if (!error)
+					{
+						error = signature_work (block_a.signature, block_a.work);
+					}
+				}
+			}
+		}
+		return error;
+	}
+	bool decode (mol::change_block & block_a) const
+	{
+		std::string const * previous_l;
+		std::string const * representative_l;
+		auto error (get (block_json_field::previous, previous_l) || get (block_json_field::representative, representative_l));
+		if (!error)
+		{
+			error = block_a.hashables.previous.decode_hex (*previous_l);
+			if (!error)
+			{
+				error = block_a.hashables.representative.decode_account (*representative_l);
+				if (!error)
+				{
+					error = signature_work (block_a.signature, block_a.work);
+				}
+			}
+		}
+		return error;
+	}
+	bool decode (mol::state_block & block_a) const
+	{
+		std::string const * account_l;
+		std::string const * previous_l;
+		std::string const * representative_l;
+		std::string const * balance_l;
+		std::string const * link_l;
+		auto error (get (block_json_field::account, account_l) || get (block_json_field::previous, previous_l) || get (block_json_field::representative, representative_l) || get (block_json_field::balance, balance_l) || get (block_json_field::link, link_l));
+		if (!error)
+		{
+			error = block_a.hashables.account.decode_account (*account_l);
+			if (!error)
+			{
+				error = block_a.hashables.previous.decode_hex (*previous_l);
+				if (!error)
+				{
+					error = block_a.hashables.representative.decode_account (*representative_l);
+					if (!error)
+					{
+						error = block_a.hashables.balance.decode_dec (*balance_l);
+						if (!error)
+						{
+							error = block_a.hashables.link.decode_account (*link_l) && block_a.hashables.link.decode_hex (*link_l);
+							if (!error)
+							{
+								error = signature_work (block_a.signature, block_a.work);
+							}
+						}
+					}
+				}
+			}
+		}
+		return error;
+	}
+	bool decode (mol::astate_block & block_a) const
+	{
+		std::string const * account_l;
+		std::string const * previous_l;
+		std::string const * representative_l;
+		std::string const * balance_l;
+		std::string const * link_l;
+		std::string const * asset_l;
+		std::string const * genesis_account_l;
+		std::string const * identifier_l;
+		auto error (get (block_json_field::account, account_l) || get (block_json_field::previous, previous_l) || get (block_json_field::representative, representative_l) || get (block_json_field::balance, balance_l) || get (block_json_field::link, link_l) || get (block_json_field::asset, asset_l) || get (block_json_field::genesis_account, genesis_account_l) || get (block_json_field::identifier, identifier_l));
+		if (!error)
+		{
+			error = block_a.hashables.account.decode_account (*account_l);
+			if (!error)
+			{
+				error = block_a.hashables.previous.decode_hex (*previous_l);
+				if (!error)
+				{
+					error = block_a.hashables.representative.decode_account (*representative_l);
+					if (!error)
+					{
+						error = block_a.hashables.balance.decode_dec (*balance_l);
+						if (!error)
+						{
+							error = block_a.hashables.link.decode_account (*link_l) && block_a.hashables.link.decode_hex (*link_l);
+							if (!error)
+							{
+								error = block_a.hashables.asset.decode_hex (*asset_l);
+								if (!error)
+								{
+									error = block_a.hashables.genesis_account.decode_account (*genesis_account_l) && block_a.hashables.genesis_account.decode_hex (*genesis_account_l);
+									if (!error)
+									{
+										// Identifiers are one to three characters followed by the terminator
+										error = identifier_l->empty () || identifier_l->size () >= sizeof (block_a.identifier);
+										if (!error)
+										{
+											std::fill (block_a.identifier, block_a.identifier + sizeof (block_a.identifier), '\0');
+											std::copy (identifier_l->begin (), identifier_l->end (), block_a.identifier);
+											error = signature_work (block_a.signature, block_a.work);
+										}
+									}
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+		return error;
+	}
+
+private:
+	bool signature_work (mol::signature & signature_a, uint64_t & work_a) const
+	{
+		std::string const * signature_l;
+		std::string const * work_l;
+		auto error (get (block_json_field::signature, signature_l) || get (block_json_field::work, work_l));
+		if (!error)
+		{
+			error = mol::from_string_hex (*work_l, work_a);
+			if (!error)
+			{
+				error = signature_a.decode_hex (*signature_l);
+			}
+		}
+		return error;
+	}
+	static block_json_field lookup (std::string const & key_a)
+	{
+		static std::array<char const *, static_cast<size_t> (block_json_field::count)> const names = { { "type", "account", "previous", "representative", "balance", "link", "source", "destination", "asset", "genesis_account", "identifier", "signature", "work" } };
+		auto result (block_json_field::count);
+		for (size_t i (0); i < names.size () && result == block_json_field::count; ++i)
+		{
+			if (key_a == names[i])
+			{
+				result = static_cast<block_json_field> (i);
+			}
+		}
+		return result;
+	}
+	void whitespace ()
+	{
+		while (position != end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+		{
+			++position;
+		}
+	}
+	bool expect (char char_a)
+	{
+		whitespace ();
+		auto result (position == end || *position != char_a);
+		if (!result)
+		{
+			++position;
+		}
+		return result;
+	}
+	// Read one value, strings are stored in `slot_a' if it's not null, scalars are stored as written and nested values are skipped
+	bool value (std::string * slot_a)
+	{
+		whitespace ();
+		auto error (position == end);
+		if (!error)
+		{
+			std::string discard;
+			auto & target (slot_a != nullptr ? *slot_a : discard);
+			target.clear ();
+			switch (*position)
+			{
+				case '"':
+					++position;
+					error = string (target);
+					break;
+				case '{':
+				case '[':
+					error = nested ();
+					break;
+				default:
+				{
+					auto begin (position);
+					while (position != end && *position != ',' && *position != '}' && *position != ']' && *position != ' ' && *position != '\t' && *position != '\n' && *position != '\r')
+					{
+						++position;
+					}
+					target.assign (begin, position);
+					error = !literal (target);
+					break;
+				}
+			}
+		}
+		return error;
+	}
+	static bool literal (std::string const & text_a)
+	{
+		auto result (text_a == "true" || text_a == "false" || text_a == "null");
+		if (!result)
+		{
+			// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+			auto i (text_a.begin ());
+			auto n (text_a.end ());
+			auto digits ([&i, n]() {
+				auto begin (i);
+				while (i != n && *i >= '0' && *i <= '9')
+				{
+					++i;
+				}
+				return i - begin;
+			});
+			if (i != n && *i == '-')
+			{
+				++i;
+			}
+			auto leading (i != n && *i == '0');
+			auto integer (digits ());
+			result = integer == 1 || (integer > 1 && !leading);
+			if (result && i != n && *i == '.')
+			{
+				++i;
+				result = digits () > 0;
+			}
+			if (result && i != n && (*i == 'e' || *i == 'E'))
+			{
+				++i;
+				if (i != n && (*i == '+' || *i == '-'))
+				{
+					++i;
+				}
+				result = digits () > 0;
+			}
+			result = result && i == n;
+		}
+		return result;
+	}
+	// Skip an object or array, checking its structure the way read_json would
+	bool nested (size_t depth_a = 0)
+	{
+		auto close (*position == '{' ? '}' : ']');
+		auto object (close == '}');
+		++position;
+		whitespace ();
+		auto error (depth_a > 64 || position == end);
+		if (!error && *position == close)
+		{
+			++position;
+		}
+		else
+		{
+			auto done (false);
+			while (!error && !done)
+			{
+				if (object)
+				{
+					std::string discard;
+					error = expect ('"') || string (discard) || expect (':');
+				}
+				if (!error)
+				{
+					whitespace ();
+					error = position == end;
+					if (!error)
+					{
+						error = *position == '{' || *position == '[' ? nested (depth_a + 1) : value (nullptr);
+						if (!error)
+						{
+							whitespace ();
+							if (position != end && *position == ',')
+							{
+								++position;
+							}
+							else
+							{
+								error = expect (close);
+								done = true;
+							}
+						}
+					}
+				}
+			}
+		}
+		return error;
+	}
+	// Read the remainder of a string whose opening quote has been consumed, decoding escapes to UTF-8
+	bool string (std::string & result_a)
+	{
+		auto error (false);
+		auto done (false);
+		while (!error && !done)
+		{
+			error = position == end;
+			if (!error)
+			{
+				auto c (*position++);
+				if (c == '"')
+				{
+					done = true;
+				}
+				else if (c == '\\')
+				{
+					error = escape (result_a);
+				}
+				else
+				{
+					error = static_cast<unsigned char> (c) < 0x20;
+					result_a.push_back (c);
+				}
+			}
+		}
+		return error;
+	}
+	bool escape (std::string & result_a)
+	{
+		auto error (position == end);
+		if (!error)
+		{
+			auto c (*position++);
+			switch (c)
+			{
+				case '"':
+				case '\\':
+				case '/':
+					result_a.push_back (c);
+					break;
+				case 'b':
+					result_a.push_back ('\b');
+					break;
+				case 'f':
+					result_a.push_back ('\f');
+					break;
+				case 'n':
+					result_a.push_back ('\n');
+					break;
+				case 'r':
+					result_a.push_back ('\r');
+					break;
+				case 't':
+					result_a.push_back ('\t');
+					break;
+				case 'u':
+				{
+					uint32_t code;
+					// A low surrogate may only follow a high one
+					error = hex4 (code) || (code >= 0xdc00 && code <= 0xdfff);
+					if (!error && code >= 0xd800 && code <= 0xdbff)
+					{
+						// High surrogate, must be followed by an escaped low surrogate
+						uint32_t low;
+						error = end - position < 2 || position[0] != '\\' || position[1] != 'u';
+						if (!error)
+						{
+							position += 2;
+							error = hex4 (low) || low < 0xdc00 || low > 0xdfff;
+							code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+						}
+					}
+					if (!error)
+					{
+						utf8 (code, result_a);
+					}
+					break;
+				}
+				default:
+					error = true;
+					break;
+			}
+		}
+		return error;
+	}
+	bool hex4 (uint32_t & code_a)
+	{
+		auto error (end - position < 4);
+		code_a = 0;
+		for (auto i (0); !error && i < 4; ++i)
+		{
+			auto c (*position++);
+			code_a <<= 4;
+			if (c >= '0' && c <= '9')
+			{
+				code_a |= c - '0';
+			}
+			else if (c >= 'a' && c <= 'f')
+			{
+				code_a |= c - 'a' + 10;
+			}
+			else if (c >= 'A' && c <= 'F')
+			{
+				code_a |= c - 'A' + 10;
+			}
+			else
+			{
+				error = true;
+			}
+		}
+		return error;
+	}
+	static void utf8 (uint32_t code_a, std::string & result_a)
+	{
+		if (code_a < 0x80)
+		{
+			result_a.push_back (static_cast<char> (code_a));
+		}
+		else if (code_a < 0x800)
+		{
+			result_a.push_back (static_cast<char> (0xc0 | (code_a >> 6)));
+			result_a.push_back (static_cast<char> (0x80 | (code_a & 0x3f)));
+		}
+		else if (code_a < 0x10000)
+		{
+			result_a.push_back (static_cast<char> (0xe0 | (code_a >> 12)));
+			result_a.push_back (static_cast<char> (0x80 | ((code_a >> 6) & 0x3f)));
+			result_a.push_back (static_cast<char> (0x80 | (code_a & 0x3f)));
+		}
+		else
+		{
+			result_a.push_back (static_cast<char> (0xf0 | (code_a >> 18)));
+			result_a.push_back (static_cast<char> (0x80 | ((code_a >> 12) & 0x3f)));
+			result_a.push_back (static_cast<char> (0x80 | ((code_a >> 6) & 0x3f)));
+			result_a.push_back (static_cast<char> (0x80 | (code_a & 0x3f)));
+		}
+	}
+	char const * position;
+	char const * end;
+	std::array<std::string, static_cast<size_t> (block_json_field::count)> values;
+	std::array<bool, static_cast<size_t> (block_json_field::count)> present;
+};
+
+template <typename T>
+std::unique_ptr<mol::block> decode_block_json (block_json_reader const & reader_a)
+{
+	std::unique_ptr<mol::block> result;
+	std::unique_ptr<T> obj (new T);
+	if (!reader_a.decode (*obj))
+	{
+		result = std::move (obj);
+	}
+	return result;
+}
+}
+
+std::unique_ptr<mol::block> mol::deserialize_block_json (std::string const & text_a)
+{
+	std::unique_ptr<mol::block> result;
+	block_json_reader reader (text_a);
+	std::string const * type;
+	if (!reader.parse () && !reader.get (block_json_field::type, type))
+	{
+		if (*type == "receive")
+		{
+			result = decode_block_json<mol::receive_block> (reader);
+		}
+		else if (*type == "send")
+		{
+			result = decode_block_json<mol::send_block> (reader);
+		}
+		else if (*type == "open")
+		{
+			result = decode_block_json<mol::open_block> (reader);
+		}
+		else if (*type == "change")
+		{
+			result = decode_block_json<mol::change_block> (reader);
+		}
+		else if (*type == "state")
+		{
+			result = decode_block_json<mol::state_block> (reader);
+		}
+		else if (*type == "astate")
+		{
+			result = decode_block_json<mol::astate_block> (reader);
+		}
+	}
+	return result;
+}
+
 std::unique_ptr<mol::block> mol::deserialize_block (mol::stream & stream_a)
 {
 	mol::block_type type;
@@ -1250,6 +2526,16 @@ std::unique_ptr<mol::block> mol::deserialize_block (mol::stream & stream_a, mol:
 			}
 			break;
 		}
+		case mol::block_type::astate:
+		{
+			bool error;
+			std::unique_ptr<mol::astate_block> obj (new mol::astate_block (error, stream_a));
+			if (!error)
+			{
+				result = std::move (obj);
+			}
+			break;
+		}
 		default:
 			assert (false);
 			break;
@@ -1257,6 +2543,16 @@ std::unique_ptr<mol::block> mol::deserialize_block (mol::stream & stream_a, mol:
 	return result;
 }
 
+void * mol::receive_block::operator new (size_t size_a)
+{
+	return mol::block_pool<mol::receive_block>::operator_new (size_a);
+}
+
+void mol::receive_block::operator delete (void * block_a, size_t size_a)
+{
+	mol::block_pool<mol::receive_block>::operator_delete (block_a, size_a);
+}
+
 void mol::receive_block::visit (mol::block_visitor & visitor_a) const
 {
 	visitor_a.receive_block (*this);
@@ -1270,6 +2566,7 @@ bool mol::receive_block::operator== (mol::receive_block const & other_a) const
 
 bool mol::receive_block::deserialize (mol::stream & stream_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	error = read (stream_a, hashables.previous.bytes);
 	if (!error)
@@ -1289,6 +2586,7 @@ bool mol::receive_block::deserialize (mol::stream & stream_a)
 
 bool mol::receive_block::deserialize_json (boost::property_tree::ptree const & tree_a)
 {
+	hash_invalidate ();
 	auto error (false);
 	try
 	{
@@ -1328,21 +2626,13 @@ void mol::receive_block::serialize (mol::stream & stream_a) const
 
 void mol::receive_block::serialize_json (std::string & string_a) const
 {
-	boost::property_tree::ptree tree;
-	tree.put ("type", "receive");
-	std::string previous;
-	hashables.previous.encode_hex (previous);
-	tree.put ("previous", previous);
-	std::string source;
-	hashables.source.encode_hex (source);
-	tree.put ("source", source);
-	std::string signature_l;
-	signature.encode_hex (signature_l);
-	tree.put ("work", mol::to_string_hex (work));
-	tree.put ("signature", signature_l);
-	std::stringstream ostream;
-	boost::property_tree::write_json (ostream, tree);
-	string_a = ostream.str ();
+	json_block_writer writer (string_a);
+	writer.put ("type", "receive");
+	writer.put_hex ("previous", hashables.previous.bytes);
+	writer.put_hex ("source", hashables.source.bytes);
+	writer.put_work ("work", work);
+	writer.put_hex ("signature", signature.bytes);
+	writer.finish ();
 }
 
 mol::receive_block::receive_block (mol::block_hash const & previous_a, mol::block_hash const & source_a, mol::raw_key const & prv_a, mol::public_key const & pub_a, uint64_t work_a) :
@@ -1453,6 +2743,7 @@ mol::signature mol::receive_block::block_signature () const
 void mol::receive_block::signature_set (mol::uint512_union const & signature_a)
 {
 	signature = signature_a;
+	signature_verified_clear ();
 }
 
 mol::block_type mol::receive_block::type () const
@@ -1661,14 +2952,12 @@ mol::astate_block::astate_block (bool & error_a, boost::property_tree::ptree con
 					error_a = signature.decode_hex (signature_l);
 					if (!error_a) {
 
-						strcpy(identifier, identifier_l.c_str());
-						if (strlen(identifier) == 0) {
-
-							error_a = true;
-
-						} else {
+						// Identifiers are one to three characters followed by the terminator
+						error_a = identifier_l.empty () || identifier_l.size () >= sizeof (identifier);
+						if (!error_a) {
 
-							error_a = false;
+							std::fill (identifier, identifier + sizeof (identifier), '\0');
+							std::copy (identifier_l.begin (), identifier_l.end (), identifier);
 						}
 
 					}
@@ -1723,39 +3012,33 @@ void mol::astate_block::serialize (mol::stream & stream_a) const
 
 void mol::astate_block::serialize_json (std::string & string_a) const
 {
-	boost::property_tree::ptree tree;
-	tree.put ("type", "astate");
-	tree.put ("account", hashables.account.to_account ());
-	tree.put ("previous", hashables.previous.to_string ());
-	tree.put ("representative", representative ().to_account ());
-	tree.put ("balance", hashables.balance.to_string_dec ());
-	tree.put ("link", hashables.link.to_string ());
-	tree.put ("link_as_account", hashables.link.to_account ());
-
-	tree.put ("asset", hashables.asset.to_string());
-	if (hashables.genesis_account.is_zero()) {
-		tree.put("genesis_account", hashables.genesis_account.to_string());
-	} else {
-		tree.put("genesis_account", hashables.genesis_account.to_account());
+	json_block_writer writer (string_a);
+	writer.put ("type", "astate");
+	writer.put ("account", hashables.account.to_account ());
+	writer.put_hex ("previous", hashables.previous.bytes);
+	writer.put ("representative", representative ().to_account ());
+	writer.put_dec ("balance", hashables.balance);
+	writer.put_hex ("link", hashables.link.bytes);
+	writer.put ("link_as_account", hashables.link.to_account ());
+	writer.put_hex ("asset", hashables.asset.bytes);
+	if (hashables.genesis_account.is_zero ())
+	{
+		writer.put_hex ("genesis_account", hashables.genesis_account.bytes);
 	}
-
-	std::string signature_l;
-	signature.encode_hex (signature_l);
-	tree.put ("signature", signature_l);
-	tree.put ("work", mol::to_string_hex (work));
-
-	std::string identifier_l = identifier;
-	tree.put ("identifier", identifier_l);
-
-	std::stringstream ostream;
-	boost::property_tree::write_json (ostream, tree);
-	string_a = ostream.str ();
-
-	std::cout << "mol::astate_block::serialize_json next==" << string_a << "==end next" << std::endl;
+	else
+	{
+		writer.put ("genesis_account", hashables.genesis_account.to_account ());
+	}
+	writer.put_hex ("signature", signature.bytes);
+	writer.put_work ("work", work);
+	writer.put ("identifier", std::string (identifier, std::find (identifier, identifier + 3, '\0')));
+	writer.finish ();
 }
 
 bool mol::astate_block::deserialize (mol::stream & stream_a) {
 
+	hash_invalidate ();
+
 	auto error (read (stream_a, hashables.account));
 	if (!error) {
 
@@ -1808,6 +3091,8 @@ bool mol::astate_block::deserialize (mol::stream & stream_a) {
 
 bool mol::astate_block::deserialize_json (boost::property_tree::ptree const & tree_a) {
 
+	hash_invalidate ();
+
 	auto error (false);
 	try {
 
@@ -1847,11 +3132,11 @@ bool mol::astate_block::deserialize_json (boost::property_tree::ptree const & tr
 								error = hashables.genesis_account.decode_account(genesis_account_l) && hashables.genesis_account.decode_hex(genesis_account_l);
 								if (!error) {
 
-									strcpy(identifier, identifier_l.c_str());
-									if (strlen(identifier) == 0) {
-										error = true;
-									} else {
-										error = false;
+									error = identifier_l.empty () || identifier_l.size () >= sizeof (identifier);
+									if (!error) {
+
+										std::fill (identifier, identifier + sizeof (identifier), '\0');
+										std::copy (identifier_l.begin (), identifier_l.end (), identifier);
 									}
 
 									if (!error) {
@@ -1881,6 +3166,16 @@ bool mol::astate_block::deserialize_json (boost::property_tree::ptree const & tr
 	return error;
 }
 
+void * mol::astate_block::operator new (size_t size_a)
+{
+	return mol::block_pool<mol::astate_block>::operator_new (size_a);
+}
+
+void mol::astate_block::operator delete (void * block_a, size_t size_a)
+{
+	mol::block_pool<mol::astate_block>::operator_delete (block_a, size_a);
+}
+
 void mol::astate_block::visit (mol::block_visitor & visitor_a) const
 {
 	visitor_a.astate_block (*this);
@@ -1945,5 +3240,272 @@ std::string mol::astate_block::block_identifier () {
 void mol::astate_block::signature_set (mol::uint512_union const & signature_a)
 {
 	signature = signature_a;
+	signature_verified_clear ();
 }
 //added by sandy - e
+
+namespace
+{
+/** Copy a fixed size field out of a serialized block, the viewed memory carries no alignment guarantee */
+template <typename T>
+T view_field (uint8_t const * data_a, size_t offset_a)
+{
+	T result;
+	std::copy (data_a + offset_a, data_a + offset_a + result.bytes.size (), result.bytes.begin ());
+	return result;
+}
+
+uint64_t view_work (uint8_t const * data_a, size_t offset_a, bool big_endian_a)
+{
+	uint64_t result;
+	std::copy (data_a + offset_a, data_a + offset_a + sizeof (result), reinterpret_cast<uint8_t *> (&result));
+	if (big_endian_a)
+	{
+		boost::endian::big_to_native_inplace (result);
+	}
+	return result;
+}
+
+/** Offsets of the serialized send block fields, the hashables come first followed by signature and work */
+class send_layout
+{
+public:
+	static size_t constexpr previous = 0;
+	static size_t constexpr destination = previous + sizeof (mol::send_hashables::previous);
+	static size_t constexpr balance = destination + sizeof (mol::send_hashables::destination);
+	static size_t constexpr signature = balance + sizeof (mol::send_hashables::balance);
+	static size_t constexpr work = signature + sizeof (mol::send_block::signature);
+	static size_t constexpr end = work + sizeof (mol::send_block::work);
+};
+static_assert (send_layout::end == mol::send_block::size, "Send block view layout doesn't match the serialized size");
+
+class state_layout
+{
+public:
+	static size_t constexpr account = 0;
+	static size_t constexpr previous = account + sizeof (mol::state_hashables::account);
+	static size_t constexpr representative = previous + sizeof (mol::state_hashables::previous);
+	static size_t constexpr balance = representative + sizeof (mol::state_hashables::representative);
+	static size_t constexpr link = balance + sizeof (mol::state_hashables::balance);
+	static size_t constexpr signature = link + sizeof (mol::state_hashables::link);
+	static size_t constexpr work = signature + sizeof (mol::state_block::signature);
+	static size_t constexpr end = work + sizeof (mol::state_block::work);
+};
+static_assert (state_layout::end == mol::state_block::size, "State block view layout doesn't match the serialized size");
+
+class astate_layout
+{
+public:
+	static size_t constexpr account = 0;
+	static size_t constexpr previous = account + sizeof (mol::astate_hashables::account);
+	static size_t constexpr representative = previous + sizeof (mol::astate_hashables::previous);
+	static size_t constexpr balance = representative + sizeof (mol::astate_hashables::representative);
+	static size_t constexpr link = balance + sizeof (mol::astate_hashables::balance);
+	static size_t constexpr asset = link + sizeof (mol::astate_hashables::link);
+	static size_t constexpr genesis_account = asset + sizeof (mol::astate_hashables::asset);
+	static size_t constexpr signature = genesis_account + sizeof (mol::astate_hashables::genesis_account);
+	static size_t constexpr work = signature + sizeof (mol::astate_block::signature);
+	static size_t constexpr identifier = work + sizeof (mol::astate_block::work);
+	static size_t constexpr end = identifier + sizeof (mol::astate_block::identifier);
+};
+static_assert (astate_layout::end == mol::astate_block::size, "Astate block view layout doesn't match the serialized size");
+
+mol::block_hash view_hash (mol::block_type type_a, uint8_t const * data_a, size_t size_a)
+{
+	mol::uint256_union result;
+	blake2b_state hash_l;
+	auto status (blake2b_init (&hash_l, sizeof (result.bytes)));
+	assert (status == 0);
+	if (type_a == mol::block_type::state || type_a == mol::block_type::astate)
+	{
+		mol::uint256_union preamble (static_cast<uint64_t> (type_a));
+		blake2b_update (&hash_l, preamble.bytes.data (), preamble.bytes.size ());
+	}
+	blake2b_update (&hash_l, data_a, size_a);
+	status = blake2b_final (&hash_l, result.bytes.data (), sizeof (result.bytes));
+	assert (status == 0);
+	return result;
+}
+}
+
+mol::send_block_view::send_block_view (bool & error_a, uint8_t const * data_a, size_t size_a) :
+data (data_a)
+{
+	error_a = size_a < mol::send_block::size;
+}
+
+mol::block_hash mol::send_block_view::hash () const
+{
+	return view_hash (mol::block_type::send, data, send_layout::signature);
+}
+
+mol::block_hash mol::send_block_view::previous () const
+{
+	return view_field<mol::block_hash> (data, send_layout::previous);
+}
+
+mol::account mol::send_block_view::destination () const
+{
+	return view_field<mol::account> (data, send_layout::destination);
+}
+
+mol::amount mol::send_block_view::balance () const
+{
+	return view_field<mol::amount> (data, send_layout::balance);
+}
+
+mol::block_hash mol::send_block_view::source () const
+{
+	return 0;
+}
+
+mol::block_hash mol::send_block_view::root () const
+{
+	return previous ();
+}
+
+mol::account mol::send_block_view::representative () const
+{
+	return 0;
+}
+
+mol::signature mol::send_block_view::block_signature () const
+{
+	return view_field<mol::signature> (data, send_layout::signature);
+}
+
+uint64_t mol::send_block_view::block_work () const
+{
+	return view_work (data, send_layout::work, false);
+}
+
+mol::state_block_view::state_block_view (bool & error_a, uint8_t const * data_a, size_t size_a) :
+data (data_a)
+{
+	error_a = size_a < mol::state_block::size;
+}
+
+mol::block_hash mol::state_block_view::hash () const
+{
+	return view_hash (mol::block_type::state, data, state_layout::signature);
+}
+
+mol::account mol::state_block_view::account () const
+{
+	return view_field<mol::account> (data, state_layout::account);
+}
+
+mol::block_hash mol::state_block_view::previous () const
+{
+	return view_field<mol::block_hash> (data, state_layout::previous);
+}
+
+mol::account mol::state_block_view::representative () const
+{
+	return view_field<mol::account> (data, state_layout::representative);
+}
+
+mol::amount mol::state_block_view::balance () const
+{
+	return view_field<mol::amount> (data, state_layout::balance);
+}
+
+mol::uint256_union mol::state_block_view::link () const
+{
+	return view_field<mol::uint256_union> (data, state_layout::link);
+}
+
+mol::block_hash mol::state_block_view::source () const
+{
+	return 0;
+}
+
+mol::block_hash mol::state_block_view::root () const
+{
+	auto previous_l (previous ());
+	return !previous_l.is_zero () ? previous_l : account ();
+}
+
+mol::signature mol::state_block_view::block_signature () const
+{
+	return view_field<mol::signature> (data, state_layout::signature);
+}
+
+uint64_t mol::state_block_view::block_work () const
+{
+	return view_work (data, state_layout::work, true);
+}
+
+mol::astate_block_view::astate_block_view (bool & error_a, uint8_t const * data_a, size_t size_a) :
+data (data_a)
+{
+	error_a = size_a < mol::astate_block::size;
+}
+
+mol::block_hash mol::astate_block_view::hash () const
+{
+	return view_hash (mol::block_type::astate, data, astate_layout::signature);
+}
+
+mol::account mol::astate_block_view::account () const
+{
+	return view_field<mol::account> (data, astate_layout::account);
+}
+
+mol::block_hash mol::astate_block_view::previous () const
+{
+	return view_field<mol::block_hash> (data, astate_layout::previous);
+}
+
+mol::account mol::astate_block_view::representative () const
+{
+	return view_field<mol::account> (data, astate_layout::representative);
+}
+
+mol::amount mol::astate_block_view::balance () const
+{
+	return view_field<mol::amount> (data, astate_layout::balance);
+}
+
+mol::uint256_union mol::astate_block_view::link () const
+{
+	return view_field<mol::uint256_union> (data, astate_layout::link);
+}
+
+mol::asset mol::astate_block_view::asset () const
+{
+	return view_field<mol::asset> (data, astate_layout::asset);
+}
+
+mol::account mol::astate_block_view::genesis_account () const
+{
+	return view_field<mol::account> (data, astate_layout::genesis_account);
+}
+
+mol::block_hash mol::astate_block_view::source () const
+{
+	return 0;
+}
+
+mol::block_hash mol::astate_block_view::root () const
+{
+	auto previous_l (previous ());
+	return !previous_l.is_zero () ? previous_l : account ();
+}
+
+mol::signature mol::astate_block_view::block_signature () const
+{
+	return view_field<mol::signature> (data, astate_layout::signature);
+}
+
+uint64_t mol::astate_block_view::block_work () const
+{
+	return view_work (data, astate_layout::work, true);
+}
+
+std::string mol::astate_block_view::block_identifier () const
+{
+	// Identifiers are at most three characters, the fourth byte is the terminator
+	auto identifier (reinterpret_cast<char const *> (data + astate_layout::identifier));
+	return std::string (identifier, std::find (identifier, identifier + 3, '\0'));
+}
@@ -3,14 +3,19 @@
 #include <mol/lib/numbers.hpp>
 
 #include <assert.h>
+#include <atomic>
 #include <blake2/blake2.h>
 #include <boost/property_tree/json_parser.hpp>
+#include <mutex>
 #include <streambuf>
+#include <vector>
 
 namespace mol
 {
 std::string to_string_hex (uint64_t);
 bool from_string_hex (std::string const &, uint64_t &);
+// Appends a string value, without quotes, escaped the way boost::property_tree::write_json escapes it
+void json_escape (std::string &, std::string const &);
 // We operate on streams of uint8_t by convention
 using stream = std::basic_streambuf<uint8_t>;
 // Read a raw byte stream the size of `T' and fill value.
@@ -28,6 +33,213 @@ void write (mol::stream & stream_a, T const & value)
 	auto amount_written (stream_a.sputn (reinterpret_cast<uint8_t const *> (&value), sizeof (value)));
 	assert (amount_written == sizeof (value));
 }
+/**
+ * Fixed size allocator backing operator new/delete of a block type.
+ * Each thread keeps its own free list so allocating and freeing don't contend, slots are carved out of slabs
+ * of `batch' blocks and surplus slots are handed back to a shared list in whole batches.
+ * Free slots in the shared list beyond `shared_limit' are dropped, a slab is returned to the system allocator once all of its slots
+ * have been dropped so the peak of a large scan doesn't stay resident.
+ */
+template <typename T>
+class block_pool
+{
+public:
+	static void * allocate ()
+	{
+		auto & local (cache ());
+		if (local.head == nullptr)
+		{
+			refill (local);
+		}
+		auto result (local.head);
+		local.head = result->next;
+		--local.count;
+		return result;
+	}
+	static void deallocate (void * block_a)
+	{
+		auto & local (cache ());
+		auto slot_l (static_cast<slot *> (block_a));
+		if (!local.exited)
+		{
+			slot_l->next = local.head;
+			local.head = slot_l;
+			++local.count;
+			if (local.count >= 2 * batch)
+			{
+				release (local, batch);
+			}
+		}
+		else
+		{
+			// Blocks destroyed during thread teardown go straight back to the shared list
+			slot_l->next = nullptr;
+			push (slot_l, 1);
+		}
+	}
+	// Backing for a block type's class specific operator new/delete, types derived from it use the global allocator
+	static void * operator_new (size_t size_a)
+	{
+		return size_a == sizeof (T) ? allocate () : ::operator new (size_a);
+	}
+	static void operator_delete (void * block_a, size_t size_a)
+	{
+		if (size_a == sizeof (T))
+		{
+			deallocate (block_a);
+		}
+		else
+		{
+			::operator delete (block_a);
+		}
+	}
+	static size_t constexpr batch = 64;
+	static size_t constexpr shared_limit = 64 * batch;
+
+private:
+	class slab;
+	// The storage comes first so a slot and the block it holds share an address
+	class slot
+	{
+	public:
+		union
+		{
+			slot * next;
+			typename std::aligned_storage<sizeof (T), alignof (T)>::type storage;
+		};
+		slab * owner;
+	};
+	class slab
+	{
+	public:
+		// Slots not yet dropped from the free lists
+		std::atomic<size_t> live;
+		slot slots[batch];
+	};
+	// Trivially destructible so it stays usable while other thread locals are being torn down
+	class free_list
+	{
+	public:
+		slot * head;
+		size_t count;
+		bool registered;
+		bool exited;
+	};
+	class flush_on_exit
+	{
+	public:
+		flush_on_exit (free_list & local_a) :
+		local (local_a)
+		{
+		}
+		~flush_on_exit ()
+		{
+			release (local, local.count);
+			local.exited = true;
+		}
+		free_list & local;
+	};
+	class shared_lists
+	{
+	public:
+		std::mutex mutex;
+		std::vector<std::pair<slot *, size_t>> lists;
+		// Slots across all lists
+		size_t count;
+	};
+	static free_list & cache ()
+	{
+		static thread_local free_list result;
+		if (!result.registered)
+		{
+			result.registered = true;
+			static thread_local flush_on_exit flush (result);
+		}
+		return result;
+	}
+	static shared_lists & shared ()
+	{
+		// Never destroyed, blocks owned by other statics may be freed after this would have been
+		static auto result (new shared_lists ());
+		return *result;
+	}
+	static void refill (free_list & local_a)
+	{
+		{
+			std::lock_guard<std::mutex> lock (shared ().mutex);
+			auto & lists (shared ().lists);
+			if (!lists.empty ())
+			{
+				local_a.head = lists.back ().first;
+				local_a.count = lists.back ().second;
+				shared ().count -= local_a.count;
+				lists.pop_back ();
+			}
+		}
+		if (local_a.head == nullptr)
+		{
+			auto slab_l (new slab);
+			slab_l->live = batch;
+			slot * head (nullptr);
+			for (auto & i : slab_l->slots)
+			{
+				i.owner = slab_l;
+				i.next = head;
+				head = &i;
+			}
+			local_a.head = head;
+			local_a.count = batch;
+		}
+	}
+	static void push (slot * head_a, size_t count_a)
+	{
+		std::vector<std::pair<slot *, size_t>> surplus;
+		{
+			std::lock_guard<std::mutex> lock (shared ().mutex);
+			auto & shared_l (shared ());
+			shared_l.lists.push_back (std::make_pair (head_a, count_a));
+			shared_l.count += count_a;
+			// The oldest lists go first, the most recently freed slots are the likeliest to still be cached
+			auto end (shared_l.lists.begin ());
+			while (shared_l.count > shared_limit)
+			{
+				shared_l.count -= end->second;
+				++end;
+			}
+			surplus.assign (shared_l.lists.begin (), end);
+			shared_l.lists.erase (shared_l.lists.begin (), end);
+		}
+		for (auto & i : surplus)
+		{
+			for (auto slot_l (i.first); slot_l != nullptr;)
+			{
+				auto next (slot_l->next);
+				// Other slots of the slab may still be in use or in another free list
+				if (--slot_l->owner->live == 0)
+				{
+					delete slot_l->owner;
+				}
+				slot_l = next;
+			}
+		}
+	}
+	static void release (free_list & local_a, size_t count_a)
+	{
+		if (count_a > 0)
+		{
+			auto head (local_a.head);
+			auto tail (head);
+			for (size_t i (1); i < count_a; ++i)
+			{
+				tail = tail->next;
+			}
+			local_a.head = tail->next;
+			local_a.count -= count_a;
+			tail->next = nullptr;
+			push (head, count_a);
+		}
+	}
+};
 class block_visitor;
 enum class block_type : uint8_t
 {
@@ -37,13 +249,26 @@ enum class block_type : uint8_t
 	receive = 3,
 	open = 4,
 	change = 5,
-	state = 6
+	state = 6,
+	astate = 7
 };
+class block;
+void hash_blocks (std::vector<mol::block const *> const &, std::vector<mol::block_hash> &);
 class block
 {
 public:
 	// Return a digest of the hashables in this block.
+	// The digest is memoized, hashables must not be modified after construction without calling hash_invalidate.
 	mol::block_hash hash () const;
+	// Discard the memoized digest, called by every mutator of the hashables.
+	void hash_invalidate ();
+	// Fill hash_a with the memoized digest if one has been computed.
+	bool hash_cached (mol::block_hash & hash_a) const;
+	// Record that the signature was checked against the signing account ahead of ledger processing.
+	// The mark is dropped whenever the signature or hashables change.
+	void signature_verified_set (mol::account const &) const;
+	// Whether the signature was already checked against this signing account.
+	bool signature_verified (mol::account const &) const;
 	std::string to_json ();
 	virtual void hash (blake2b_state &) const = 0;
 	virtual uint64_t block_work () const = 0;
@@ -64,10 +289,32 @@ public:
 	virtual void signature_set (mol::uint512_union const &) = 0;
 	virtual ~block () = default;
 	virtual bool valid_predecessor (mol::block const &) const = 0;
+
+protected:
+	block ();
+	// The memoized digest is never carried over, the copy recomputes it on first use.
+	block (mol::block const &);
+	mol::block & operator= (mol::block const &);
+	void signature_verified_clear ();
+
+private:
+	friend void mol::hash_blocks (std::vector<mol::block const *> const &, std::vector<mol::block_hash> &);
+	void hash_store (mol::block_hash const &) const;
+	enum cache_state : uint8_t
+	{
+		empty = 0,
+		writing = 1,
+		ready = 2
+	};
+	mutable mol::block_hash cached_hash;
+	mutable std::atomic<uint8_t> cached_state;
+	mutable mol::account verified_account;
+	mutable std::atomic<bool> verified;
 };
 class send_hashables
 {
 public:
+	send_hashables () = default;
 	send_hashables (mol::account const &, mol::block_hash const &, mol::amount const &);
 	send_hashables (bool &, mol::stream &);
 	send_hashables (bool &, boost::property_tree::ptree const &);
@@ -79,10 +326,13 @@ public:
 class send_block : public mol::block
 {
 public:
+	send_block () = default;
 	send_block (mol::block_hash const &, mol::account const &, mol::amount const &, mol::raw_key const &, mol::public_key const &, uint64_t);
 	send_block (bool &, mol::stream &);
 	send_block (bool &, boost::property_tree::ptree const &);
 	virtual ~send_block () = default;
+	static void * operator new (size_t);
+	static void operator delete (void *, size_t);
 	using mol::block::hash;
 	void hash (blake2b_state &) const override;
 	uint64_t block_work () const override;
@@ -110,6 +360,7 @@ public:
 class receive_hashables
 {
 public:
+	receive_hashables () = default;
 	receive_hashables (mol::block_hash const &, mol::block_hash const &);
 	receive_hashables (bool &, mol::stream &);
 	receive_hashables (bool &, boost::property_tree::ptree const &);
@@ -120,10 +371,13 @@ public:
 class receive_block : public mol::block
 {
 public:
+	receive_block () = default;
 	receive_block (mol::block_hash const &, mol::block_hash const &, mol::raw_key const &, mol::public_key const &, uint64_t);
 	receive_block (bool &, mol::stream &);
 	receive_block (bool &, boost::property_tree::ptree const &);
 	virtual ~receive_block () = default;
+	static void * operator new (size_t);
+	static void operator delete (void *, size_t);
 	using mol::block::hash;
 	void hash (blake2b_state &) const override;
 	uint64_t block_work () const override;
@@ -151,6 +405,7 @@ public:
 class open_hashables
 {
 public:
+	open_hashables () = default;
 	open_hashables (mol::block_hash const &, mol::account const &, mol::account const &);
 	open_hashables (bool &, mol::stream &);
 	open_hashables (bool &, boost::property_tree::ptree const &);
@@ -162,11 +417,14 @@ public:
 class open_block : public mol::block
 {
 public:
+	open_block () = default;
 	open_block (mol::block_hash const &, mol::account const &, mol::account const &, mol::raw_key const &, mol::public_key const &, uint64_t);
 	open_block (mol::block_hash const &, mol::account const &, mol::account const &, std::nullptr_t);
 	open_block (bool &, mol::stream &);
 	open_block (bool &, boost::property_tree::ptree const &);
 	virtual ~open_block () = default;
+	static void * operator new (size_t);
+	static void operator delete (void *, size_t);
 	using mol::block::hash;
 	void hash (blake2b_state &) const override;
 	uint64_t block_work () const override;
@@ -194,6 +452,7 @@ public:
 class change_hashables
 {
 public:
+	change_hashables () = default;
 	change_hashables (mol::block_hash const &, mol::account const &);
 	change_hashables (bool &, mol::stream &);
 	change_hashables (bool &, boost::property_tree::ptree const &);
@@ -204,10 +463,13 @@ public:
 class change_block : public mol::block
 {
 public:
+	change_block () = default;
 	change_block (mol::block_hash const &, mol::account const &, mol::raw_key const &, mol::public_key const &, uint64_t);
 	change_block (bool &, mol::stream &);
 	change_block (bool &, boost::property_tree::ptree const &);
 	virtual ~change_block () = default;
+	static void * operator new (size_t);
+	static void operator delete (void *, size_t);
 	using mol::block::hash;
 	void hash (blake2b_state &) const override;
 	uint64_t block_work () const override;
@@ -235,6 +497,7 @@ public:
 class state_hashables
 {
 public:
+	state_hashables () = default;
 	state_hashables (mol::account const &, mol::block_hash const &, mol::account const &, mol::amount const &, mol::uint256_union const &);
 	state_hashables (bool &, mol::stream &);
 	state_hashables (bool &, boost::property_tree::ptree const &);
@@ -257,10 +520,13 @@ public:
 class state_block : public mol::block
 {
 public:
+	state_block () = default;
 	state_block (mol::account const &, mol::block_hash const &, mol::account const &, mol::amount const &, mol::uint256_union const &, mol::raw_key const &, mol::public_key const &, uint64_t);
 	state_block (bool &, mol::stream &);
 	state_block (bool &, boost::property_tree::ptree const &);
 	virtual ~state_block () = default;
+	static void * operator new (size_t);
+	static void operator delete (void *, size_t);
 	using mol::block::hash;
 	void hash (blake2b_state &) const override;
 	uint64_t block_work () const override;
@@ -288,6 +554,7 @@ public:
 //added by sandy - s
 class astate_hashables {
 public:
+	astate_hashables () = default;
 	astate_hashables (mol::account const &, mol::block_hash const &, mol::account const &, mol::amount const &, mol::uint256_union const &, mol::asset const &, mol::account const &);
 	astate_hashables (bool &, mol::stream &);
 	astate_hashables (bool &, boost::property_tree::ptree const &);
@@ -313,10 +580,13 @@ public:
 };
 class astate_block : public mol::block {
 public:
+	astate_block () = default;
 	astate_block (mol::account const &, mol::block_hash const &, mol::account const &, mol::amount const &, mol::uint256_union const &, mol::asset const &, mol::account const &, char const *, mol::raw_key const &, mol::public_key const &, uint64_t);
 	astate_block (bool &, mol::stream &);
 	astate_block (bool &, boost::property_tree::ptree const &);
 	virtual ~astate_block () = default;
+	static void * operator new (size_t);
+	static void operator delete (void *, size_t);
 	using mol::block::hash;
 	void hash (blake2b_state &) const override;
 	uint64_t block_work () const override;
@@ -346,6 +616,58 @@ public:
 	char identifier[4];
 };
 //added by sandy - e
+// Read-only views over the serialized form of a block, as stored in the database without the leading type byte.
+// Fields are decoded on access so scans don't allocate, the viewed memory must outlive the view.
+class send_block_view
+{
+public:
+	send_block_view (bool &, uint8_t const *, size_t);
+	mol::block_hash hash () const;
+	mol::block_hash previous () const;
+	mol::account destination () const;
+	mol::amount balance () const;
+	mol::block_hash source () const;
+	mol::block_hash root () const;
+	mol::account representative () const;
+	mol::signature block_signature () const;
+	uint64_t block_work () const;
+	uint8_t const * data;
+};
+class state_block_view
+{
+public:
+	state_block_view (bool &, uint8_t const *, size_t);
+	mol::block_hash hash () const;
+	mol::account account () const;
+	mol::block_hash previous () const;
+	mol::account representative () const;
+	mol::amount balance () const;
+	mol::uint256_union link () const;
+	mol::block_hash source () const;
+	mol::block_hash root () const;
+	mol::signature block_signature () const;
+	uint64_t block_work () const;
+	uint8_t const * data;
+};
+class astate_block_view
+{
+public:
+	astate_block_view (bool &, uint8_t const *, size_t);
+	mol::block_hash hash () const;
+	mol::account account () const;
+	mol::block_hash previous () const;
+	mol::account representative () const;
+	mol::amount balance () const;
+	mol::uint256_union link () const;
+	mol::asset asset () const;
+	mol::account genesis_account () const;
+	mol::block_hash source () const;
+	mol::block_hash root () const;
+	mol::signature block_signature () const;
+	uint64_t block_work () const;
+	std::string block_identifier () const;
+	uint8_t const * data;
+};
 class block_visitor
 {
 public:
@@ -357,8 +679,14 @@ public:
 	virtual void astate_block (mol::astate_block const &) = 0;
 	virtual ~block_visitor () = default;
 };
+// Hash each block in the batch, equivalent to calling hash () on every element.
+// Blocks of the same type are hashed in lockstep across SIMD lanes when compiled with AVX2 or SSE4.1.
+// Memoized digests are reused and freshly computed ones are stored back into the blocks.
+void hash_blocks (std::vector<mol::block const *> const &, std::vector<mol::block_hash> &);
 std::unique_ptr<mol::block> deserialize_block (mol::stream &);
 std::unique_ptr<mol::block> deserialize_block (mol::stream &, mol::block_type);
 std::unique_ptr<mol::block> deserialize_block_json (boost::property_tree::ptree const &);
+// Parse a block from JSON text in a single pass without building a property tree, accepts the same documents as the ptree overload.
+std::unique_ptr<mol::block> deserialize_block_json (std::string const &);
 void serialize_block (mol::stream &, mol::block const &);
 }
@@ -2,6 +2,8 @@
 #include <boost/property_tree/ptree.hpp>
 #include <mol/node/rpc.hpp>
 
+#include <cstring>
+
 #include <mol/lib/interface.h>
 #include <mol/node/node.hpp>
 
@@ -53,7 +55,11 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (mol::rpc::rpc_port),
 enable_control (false),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+heavy_request_limit (4),
+idle_timeout (30),
+keepalive_requests (1000),
+worker_threads (std::max (4u, std::thread::hardware_concurrency ()))
 {
 }
 
@@ -62,7 +68,11 @@ address (boost::asio::ip::address_v6::loopback ()),
 port (mol::rpc::rpc_port),
 enable_control (enable_control_a),
 frontier_request_limit (16384),
-chain_request_limit (16384)
+chain_request_limit (16384),
+heavy_request_limit (4),
+idle_timeout (30),
+keepalive_requests (1000),
+worker_threads (std::max (4u, std::thread::hardware_concurrency ()))
 {
 }
 
@@ -73,6 +83,10 @@ void mol::rpc_config::serialize_json (boost::property_tree::ptree & tree_a) cons
 	tree_a.put ("enable_control", enable_control);
 	tree_a.put ("frontier_request_limit", frontier_request_limit);
 	tree_a.put ("chain_request_limit", chain_request_limit);
+	tree_a.put ("heavy_request_limit", heavy_request_limit);
+	tree_a.put ("idle_timeout", idle_timeout);
+	tree_a.put ("keepalive_requests", keepalive_requests);
+	tree_a.put ("worker_threads", worker_threads);
 }
 
 bool mol::rpc_config::deserialize_json (boost::property_tree::ptree const & tree_a)
@@ -93,12 +107,33 @@ bool mol::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 			enable_control = tree_a.get<bool> ("enable_control");
 			auto frontier_request_limit_l (tree_a.get<std::string> ("frontier_request_limit"));
 			auto chain_request_limit_l (tree_a.get<std::string> ("chain_request_limit"));
+			auto heavy_request_limit_l (tree_a.get_optional<std::string> ("heavy_request_limit"));
+			auto idle_timeout_l (tree_a.get_optional<std::string> ("idle_timeout"));
+			auto keepalive_requests_l (tree_a.get_optional<std::string> ("keepalive_requests"));
+			auto worker_threads_l (tree_a.get_optional<std::string> ("worker_threads"));
 			try
 			{
 				port = std::stoul (port_l);
 				result = port > std::numeric_limits<uint16_t>::max ();
 				frontier_request_limit = std::stoull (frontier_request_limit_l);
 				chain_request_limit = std::stoull (chain_request_limit_l);
+				if (heavy_request_limit_l)
+				{
+					heavy_request_limit = std::stoull (*heavy_request_limit_l);
+				}
+				if (idle_timeout_l)
+				{
+					idle_timeout = std::stoull (*idle_timeout_l);
+				}
+				if (keepalive_requests_l)
+				{
+					keepalive_requests = std::stoull (*keepalive_requests_l);
+				}
+				if (worker_threads_l)
+				{
+					worker_threads = std::stoul (*worker_threads_l);
+					result = worker_threads == 0;
+				}
 			}
 			catch (std::logic_error const &)
 			{
@@ -119,10 +154,54 @@ bool mol::rpc_config::deserialize_json (boost::property_tree::ptree const & tree
 	return result;
 }
 
+mol::rpc_action_stats::rpc_action_stats ()
+{
+	for (auto & i : counts)
+	{
+		i = 0;
+	}
+	for (auto & i : rejections)
+	{
+		i = 0;
+	}
+	for (auto & i : times)
+	{
+		i = 0;
+	}
+}
+
+void mol::rpc_action_stats::add (size_t action_a, std::chrono::steady_clock::duration const & duration_a)
+{
+	counts[action_a].fetch_add (1, std::memory_order_relaxed);
+	times[action_a].fetch_add (std::chrono::duration_cast<std::chrono::microseconds> (duration_a).count (), std::memory_order_relaxed);
+}
+
+void mol::rpc_action_stats::reject (size_t action_a)
+{
+	rejections[action_a].fetch_add (1, std::memory_order_relaxed);
+}
+
+uint64_t mol::rpc_action_stats::count (size_t action_a) const
+{
+	return counts[action_a].load (std::memory_order_relaxed);
+}
+
+uint64_t mol::rpc_action_stats::rejected (size_t action_a) const
+{
+	return rejections[action_a].load (std::memory_order_relaxed);
+}
+
+uint64_t mol::rpc_action_stats::microseconds (size_t action_a) const
+{
+	return times[action_a].load (std::memory_order_relaxed);
+}
+
 mol::rpc::rpc (boost::asio::io_service & service_a, mol::node & node_a, mol::rpc_config const & config_a) :
 acceptor (service_a),
 config (config_a),
-node (node_a)
+node (node_a),
+workers (config_a.worker_threads),
+heavy_requests (0)
 {
 }
 
@@ -167,13 +246,88 @@ void mol::rpc::accept ()
 void mol::rpc::stop ()
 {
 	acceptor.close ();
+	workers.stop ();
 }
 
-mol::rpc_handler::rpc_handler (mol::node & node_a, mol::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a) :
+mol::rpc_workers::rpc_workers (unsigned threads_a) :
+stopped (false)
+{
+	for (unsigned i (0); i < threads_a; ++i)
+	{
+		threads.push_back (std::thread ([this]() { run (); }));
+	}
+}
+
+mol::rpc_workers::~rpc_workers ()
+{
+	stop ();
+}
+
+void mol::rpc_workers::push (std::function<void()> const & task_a)
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		tasks.push_back (task_a);
+	}
+	condition.notify_one ();
+}
+
+void mol::rpc_workers::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (mutex);
+		stopped = true;
+	}
+	condition.notify_all ();
+	for (auto & i : threads)
+	{
+		// The stop action runs on a worker, that thread is joined once the rpc is destroyed
+		if (i.joinable () && i.get_id () != std::this_thread::get_id ())
+		{
+			i.join ();
+		}
+	}
+}
+
+void mol::rpc_workers::run ()
+{
+	std::unique_lock<std::mutex> lock (mutex);
+	while (!stopped)
+	{
+		if (!tasks.empty ())
+		{
+			auto task (std::move (tasks.front ()));
+			tasks.pop_front ();
+			lock.unlock ();
+			task ();
+			lock.lock ();
+		}
+		else
+		{
+			condition.wait (lock);
+		}
+	}
+}
+
+mol::rpc_handler::rpc_handler (mol::node & node_a, mol::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a, std::function<void(std::string &&)> const & response_body_a) :
 body (body_a),
 node (node_a),
 rpc (rpc_a),
-response (response_a)
+response (response_a),
+response_body (response_body_a),
+streaming (false),
+batch_transaction (nullptr),
+batched (false)
+{
+}
+
+mol::rpc_handler::rpc_handler (mol::node & node_a, mol::rpc & rpc_a, std::string const & body_a, std::function<void(boost::property_tree::ptree const &)> const & response_a) :
+rpc_handler (node_a, rpc_a, body_a, response_a, [response_a](std::string && serialized_a) {
+	std::stringstream istream (serialized_a);
+	boost::property_tree::ptree tree;
+	boost::property_tree::read_json (istream, tree);
+	response_a (tree);
+})
 {
 }
 
@@ -201,6 +355,111 @@ void mol::error_response (std::function<void(boost::property_tree::ptree const &
 	response_a (response_l);
 }
 
+mol::json_writer::json_writer (std::string & string_a) :
+string (string_a)
+{
+	scopes.push_back (std::make_pair ('}', false));
+}
+
+mol::json_writer::json_writer (std::string & string_a, std::function<void(std::string const &)> const & chunk_a) :
+string (string_a),
+chunk (chunk_a)
+{
+	scopes.push_back (std::make_pair ('}', false));
+}
+
+void mol::json_writer::put (std::string const & key_a, std::string const & value_a)
+{
+	member (key_a);
+	value (value_a);
+}
+
+void mol::json_writer::push (std::string const & value_a)
+{
+	element ();
+	value (value_a);
+}
+
+void mol::json_writer::begin_object (std::string const & key_a)
+{
+	member (key_a);
+	scopes.push_back (std::make_pair ('}', false));
+}
+
+void mol::json_writer::begin_object ()
+{
+	element ();
+	scopes.push_back (std::make_pair ('}', false));
+}
+
+void mol::json_writer::begin_array (std::string const & key_a)
+{
+	member (key_a);
+	scopes.push_back (std::make_pair (']', false));
+}
+
+void mol::json_writer::end ()
+{
+	assert (!scopes.empty ());
+	auto scope (scopes.back ());
+	scopes.pop_back ();
+	if (scope.second)
+	{
+		string.push_back ('\n');
+		string.append (4 * scopes.size (), ' ');
+		string.push_back (scope.first);
+	}
+	else
+	{
+		string.append ("\"\"", 2);
+	}
+}
+
+void mol::json_writer::finish ()
+{
+	end ();
+	assert (scopes.empty ());
+	string.push_back ('\n');
+}
+
+void mol::json_writer::member (std::string const & key_a)
+{
+	assert (scopes.back ().first == '}');
+	element ();
+	string.push_back ('"');
+	mol::json_escape (string, key_a);
+	string.append ("\": ", 3);
+}
+
+void mol::json_writer::element ()
+{
+	assert (!scopes.empty ());
+	if (chunk && string.size () >= chunk_size)
+	{
+		chunk (string);
+		string.clear ();
+	}
+	auto & scope (scopes.back ());
+	if (scope.second)
+	{
+		string.push_back (',');
+	}
+	else
+	{
+		string.push_back (scope.first == '}' ? '{' : '[');
+		scope.second = true;
+	}
+	string.push_back ('\n');
+	string.append (4 * scopes.size (), ' ');
+}
+
+void mol::json_writer::value (std::string const & value_a)
+{
+	string.push_back ('"');
+	mol::json_escape (string, value_a);
+	string.push_back ('"');
+}
+
 namespace
 {
 bool decode_unsigned (std::string const & text, uint64_t & number)
@@ -223,6 +482,326 @@ bool decode_unsigned (std::string const & text, uint64_t & number)
 	result = result || end != text.size ();
 	return result;
 }
+
+// Unchecked blocks deserialized and hashed together before being written out
+size_t constexpr unchecked_batch = 1024;
+
+/** Read transaction of a request, borrowed from the enclosing batch when it shares one */
+class read_transaction
+{
+public:
+	read_transaction (mol::rpc_handler & handler_a) :
+	ledger (handler_a.node.ledger),
+	handle (handler_a.batch_transaction)
+	{
+		if (handle == nullptr)
+		{
+			owned.reset (new mol::transaction (handler_a.node.store.environment, nullptr, false));
+			handle = *owned;
+		}
+	}
+	operator MDB_txn * () const
+	{
+		return handle;
+	}
+	/*
+	 * The ledger serves weights and block counts from memory as of the latest commit. A batch's transaction stays open
+	 * across its requests, so those read the store to see the batch's snapshot like every other value.
+	 */
+	mol::uint128_t weight (mol::account const & account_a)
+	{
+		return owned != nullptr ? ledger.weight (handle, account_a) : ledger.weight_stored (handle, account_a);
+	}
+	mol::block_counts block_count ()
+	{
+		return owned != nullptr ? ledger.block_count (handle) : ledger.block_count_stored (handle);
+	}
+	std::vector<std::pair<mol::account, mol::uint128_t>> representation_list ()
+	{
+		return owned != nullptr ? ledger.representation_list (handle) : ledger.representation_list_stored (handle);
+	}
+	mol::ledger & ledger;
+	MDB_txn * handle;
+	std::unique_ptr<mol::transaction> owned;
+};
+
+/** Collects the results of a batch's requests, which may complete on other threads, and responds once all have */
+class rpc_batch
+{
+public:
+	rpc_batch (size_t size_a, std::function<void(std::string &&)> const & response_a) :
+	results (size_a),
+	completed (size_a, false),
+	remaining (size_a),
+	response (response_a)
+	{
+	}
+	void complete (size_t index_a, std::string && result_a)
+	{
+		auto done (false);
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			// Only the first response of a request counts
+			if (!completed[index_a])
+			{
+				completed[index_a] = true;
+				results[index_a] = std::move (result_a);
+				done = --remaining == 0;
+			}
+		}
+		if (done)
+		{
+			finish ();
+		}
+	}
+	void finish ()
+	{
+		std::string body;
+		body.push_back ('[');
+		for (size_t i (0), n (results.size ()); i < n; ++i)
+		{
+			auto & result (results[i]);
+			while (!result.empty () && result.back () == '\n')
+			{
+				result.pop_back ();
+			}
+			body.append (i == 0 ? "\n" : ",\n");
+			body.append (result);
+		}
+		body.append (results.empty () ? "]\n" : "\n]\n");
+		response (std::move (body));
+	}
+	std::mutex mutex;
+	std::vector<std::string> results;
+	std::vector<bool> completed;
+	size_t remaining;
+	std::function<void(std::string &&)> response;
+};
+}
+
+namespace
+{
+/** Dispatch entry of an RPC action and what the node needs to know about it before running it */
+class rpc_action
+{
+public:
+	char const * name;
+	void (mol::rpc_handler::*handler) ();
+	// Refused unless rpc.config.enable_control is set
+	bool control;
+	// Doesn't modify the ledger, wallets or node state
+	bool read_only;
+	mol::rpc_cost cost;
+	// Handled before the request is logged so the password can be removed from the logged body
+	bool redact;
+};
+
+// Sorted by name for binary search, enforced below
+rpc_action constexpr rpc_actions[] = {
+	{ "account_balance", &mol::rpc_handler::account_balance, false, true, mol::rpc_cost::light, false },
+	{ "account_block_count", &mol::rpc_handler::account_block_count, false, true, mol::rpc_cost::light, false },
+	{ "account_create", &mol::rpc_handler::account_create, true, false, mol::rpc_cost::light, false },
+	{ "account_get", &mol::rpc_handler::account_get, false, true, mol::rpc_cost::light, false },
+	{ "account_history", &mol::rpc_handler::account_history, false, true, mol::rpc_cost::medium, false },
+	{ "account_info", &mol::rpc_handler::account_info, false, true, mol::rpc_cost::light, false },
+	{ "account_key", &mol::rpc_handler::account_key, false, true, mol::rpc_cost::light, false },
+	{ "account_list", &mol::rpc_handler::account_list, false, true, mol::rpc_cost::medium, false },
+	{ "account_move", &mol::rpc_handler::account_move, true, false, mol::rpc_cost::light, false },
+	{ "account_remove", &mol::rpc_handler::account_remove, true, false, mol::rpc_cost::light, false },
+	{ "account_representative", &mol::rpc_handler::account_representative, false, true, mol::rpc_cost::light, false },
+	{ "account_representative_set", &mol::rpc_handler::account_representative_set, true, false, mol::rpc_cost::light, false },
+	{ "account_weight", &mol::rpc_handler::account_weight, false, true, mol::rpc_cost::light, false },
+	{ "accounts_balances", &mol::rpc_handler::accounts_balances, false, true, mol::rpc_cost::medium, false },
+	{ "accounts_create", &mol::rpc_handler::accounts_create, true, false, mol::rpc_cost::medium, false },
+	{ "accounts_frontiers", &mol::rpc_handler::accounts_frontiers, false, true, mol::rpc_cost::medium, false },
+	{ "accounts_pending", &mol::rpc_handler::accounts_pending, false, true, mol::rpc_cost::heavy, false },
+	{ "asset_create", &mol::rpc_handler::asset_create, true, false, mol::rpc_cost::light, false },
+	{ "asset_history", &mol::rpc_handler::asset_history, false, true, mol::rpc_cost::medium, false },
+	{ "asset_info", &mol::rpc_handler::asset_info, false, true, mol::rpc_cost::light, false },
+	{ "asset_pending", &mol::rpc_handler::asset_pending, false, true, mol::rpc_cost::medium, false },
+	{ "asset_send", &mol::rpc_handler::asset_send, true, false, mol::rpc_cost::heavy, false },
+	{ "asset_supply", &mol::rpc_handler::asset_supply, false, true, mol::rpc_cost::light, false },
+	{ "available_supply", &mol::rpc_handler::available_supply, false, true, mol::rpc_cost::medium, false },
+	{ "batch", &mol::rpc_handler::batch, false, true, mol::rpc_cost::medium, false },
+	{ "block", &mol::rpc_handler::block, false, true, mol::rpc_cost::light, false },
+	{ "block_account", &mol::rpc_handler::block_account, false, true, mol::rpc_cost::light, false },
+	{ "block_confirm", &mol::rpc_handler::block_confirm, false, false, mol::rpc_cost::light, false },
+	{ "block_count", &mol::rpc_handler::block_count, false, true, mol::rpc_cost::light, false },
+	{ "block_count_type", &mol::rpc_handler::block_count_type, false, true, mol::rpc_cost::light, false },
+	{ "block_create", &mol::rpc_handler::block_create, true, true, mol::rpc_cost::heavy, false },
+	{ "block_hash", &mol::rpc_handler::block_hash, false, true, mol::rpc_cost::light, false },
+	{ "blocks", &mol::rpc_handler::blocks, false, true, mol::rpc_cost::medium, false },
+	{ "blocks_info", &mol::rpc_handler::blocks_info, false, true, mol::rpc_cost::medium, false },
+	{ "bootstrap", &mol::rpc_handler::bootstrap, false, false, mol::rpc_cost::light, false },
+	{ "bootstrap_any", &mol::rpc_handler::bootstrap_any, false, false, mol::rpc_cost::medium, false },
+	{ "chain", &mol::rpc_handler::chain, false, true, mol::rpc_cost::medium, false },
+	{ "confirmation_history", &mol::rpc_handler::confirmation_history, false, true, mol::rpc_cost::medium, false },
+	{ "delegators", &mol::rpc_handler::delegators, false, true, mol::rpc_cost::heavy, false },
+	{ "delegators_count", &mol::rpc_handler::delegators_count, false, true, mol::rpc_cost::heavy, false },
+	{ "deterministic_key", &mol::rpc_handler::deterministic_key, false, true, mol::rpc_cost::light, false },
+	{ "frontier_count", &mol::rpc_handler::frontier_count, false, true, mol::rpc_cost::light, false },
+	{ "frontiers", &mol::rpc_handler::frontiers, false, true, mol::rpc_cost::heavy, false },
+	{ "history", &mol::rpc_handler::history, false, true, mol::rpc_cost::medium, false },
+	{ "keepalive", &mol::rpc_handler::keepalive, true, false, mol::rpc_cost::light, false },
+	{ "key_create", &mol::rpc_handler::key_create, false, true, mol::rpc_cost::light, false },
+	{ "key_expand", &mol::rpc_handler::key_expand, false, true, mol::rpc_cost::light, false },
+	{ "kmol_from_raw", &mol::rpc_handler::kmol_from_raw, false, true, mol::rpc_cost::light, false },
+	{ "kmol_to_raw", &mol::rpc_handler::kmol_to_raw, false, true, mol::rpc_cost::light, false },
+	{ "ledger", &mol::rpc_handler::ledger, true, true, mol::rpc_cost::heavy, false },
+	{ "mmol_from_raw", &mol::rpc_handler::mmol_from_raw, false, true, mol::rpc_cost::light, false },
+	{ "mmol_to_raw", &mol::rpc_handler::mmol_to_raw, false, true, mol::rpc_cost::light, false },
+	{ "mol_from_raw", &mol::rpc_handler::mol_from_raw, false, true, mol::rpc_cost::light, false },
+	{ "mol_to_raw", &mol::rpc_handler::mol_to_raw, false, true, mol::rpc_cost::light, false },
+	{ "password_change", &mol::rpc_handler::password_change, true, false, mol::rpc_cost::light, true },
+	{ "password_enter", &mol::rpc_handler::password_enter, false, false, mol::rpc_cost::light, true },
+	{ "password_valid", &mol::rpc_handler::password_valid, false, true, mol::rpc_cost::light, false },
+	{ "payment_begin", &mol::rpc_handler::payment_begin, false, false, mol::rpc_cost::light, false },
+	{ "payment_end", &mol::rpc_handler::payment_end, false, false, mol::rpc_cost::light, false },
+	{ "payment_init", &mol::rpc_handler::payment_init, false, false, mol::rpc_cost::light, false },
+	{ "payment_wait", &mol::rpc_handler::payment_wait, false, true, mol::rpc_cost::medium, false },
+	{ "peers", &mol::rpc_handler::peers, false, true, mol::rpc_cost::medium, false },
+	{ "pending", &mol::rpc_handler::pending, false, true, mol::rpc_cost::medium, false },
+	{ "pending_exists", &mol::rpc_handler::pending_exists, false, true, mol::rpc_cost::light, false },
+	{ "process", &mol::rpc_handler::process, false, false, mol::rpc_cost::medium, false },
+	{ "receive", &mol::rpc_handler::receive, true, false, mol::rpc_cost::heavy, false },
+	{ "receive_minimum", &mol::rpc_handler::receive_minimum, true, true, mol::rpc_cost::light, false },
+	{ "receive_minimum_set", &mol::rpc_handler::receive_minimum_set, true, false, mol::rpc_cost::light, false },
+	{ "representatives", &mol::rpc_handler::representatives, false, true, mol::rpc_cost::heavy, false },
+	{ "representatives_online", &mol::rpc_handler::representatives_online, false, true, mol::rpc_cost::medium, false },
+	{ "republish", &mol::rpc_handler::republish, false, false, mol::rpc_cost::heavy, false },
+	{ "search_pending", &mol::rpc_handler::search_pending, true, false, mol::rpc_cost::medium, false },
+	{ "search_pending_all", &mol::rpc_handler::search_pending_all, true, false, mol::rpc_cost::heavy, false },
+	{ "send", &mol::rpc_handler::send, true, false, mol::rpc_cost::heavy, false },
+	{ "stats", &mol::rpc_handler::stats, false, true, mol::rpc_cost::medium, false },
+	{ "stop", &mol::rpc_handler::stop, true, false, mol::rpc_cost::light, false },
+	{ "successors", &mol::rpc_handler::successors, false, true, mol::rpc_cost::medium, false },
+	{ "unchecked", &mol::rpc_handler::unchecked, false, true, mol::rpc_cost::heavy, false },
+	{ "unchecked_clear", &mol::rpc_handler::unchecked_clear, true, false, mol::rpc_cost::light, false },
+	{ "unchecked_get", &mol::rpc_handler::unchecked_get, false, true, mol::rpc_cost::light, false },
+	{ "unchecked_keys", &mol::rpc_handler::unchecked_keys, false, true, mol::rpc_cost::heavy, false },
+	{ "validate_account_number", &mol::rpc_handler::validate_account_number, false, true, mol::rpc_cost::light, false },
+	{ "version", &mol::rpc_handler::version, false, true, mol::rpc_cost::light, false },
+	{ "wallet_add", &mol::rpc_handler::wallet_add, true, false, mol::rpc_cost::light, false },
+	{ "wallet_add_watch", &mol::rpc_handler::wallet_add_watch, true, false, mol::rpc_cost::light, false },
+	{ "wallet_balance_total", &mol::rpc_handler::wallet_balance_total, false, true, mol::rpc_cost::heavy, false },
+	{ "wallet_balances", &mol::rpc_handler::wallet_balances, false, true, mol::rpc_cost::heavy, false },
+	{ "wallet_change_seed", &mol::rpc_handler::wallet_change_seed, true, false, mol::rpc_cost::light, false },
+	{ "wallet_contains", &mol::rpc_handler::wallet_contains, false, true, mol::rpc_cost::light, false },
+	{ "wallet_create", &mol::rpc_handler::wallet_create, true, false, mol::rpc_cost::light, false },
+	{ "wallet_destroy", &mol::rpc_handler::wallet_destroy, true, false, mol::rpc_cost::light, false },
+	{ "wallet_export", &mol::rpc_handler::wallet_export, false, true, mol::rpc_cost::medium, false },
+	{ "wallet_frontiers", &mol::rpc_handler::wallet_frontiers, false, true, mol::rpc_cost::heavy, false },
+	{ "wallet_key_valid", &mol::rpc_handler::wallet_key_valid, false, true, mol::rpc_cost::light, false },
+	{ "wallet_ledger", &mol::rpc_handler::wallet_ledger, false, true, mol::rpc_cost::heavy, false },
+	{ "wallet_lock", &mol::rpc_handler::wallet_lock, true, false, mol::rpc_cost::light, false },
+	{ "wallet_locked", &mol::rpc_handler::wallet_locked, false, true, mol::rpc_cost::light, false },
+	{ "wallet_pending", &mol::rpc_handler::wallet_pending, false, true, mol::rpc_cost::heavy, false },
+	{ "wallet_representative", &mol::rpc_handler::wallet_representative, false, true, mol::rpc_cost::light, false },
+	{ "wallet_representative_set", &mol::rpc_handler::wallet_representative_set, true, false, mol::rpc_cost::light, false },
+	{ "wallet_republish", &mol::rpc_handler::wallet_republish, true, false, mol::rpc_cost::heavy, false },
+	{ "wallet_unlock", &mol::rpc_handler::password_enter, false, false, mol::rpc_cost::light, true },
+	{ "wallet_work_get", &mol::rpc_handler::wallet_work_get, true, true, mol::rpc_cost::medium, false },
+	{ "work_cancel", &mol::rpc_handler::work_cancel, true, false, mol::rpc_cost::light, false },
+	{ "work_generate", &mol::rpc_handler::work_generate, true, true, mol::rpc_cost::heavy, false },
+	{ "work_get", &mol::rpc_handler::work_get, true, true, mol::rpc_cost::light, false },
+	{ "work_peer_add", &mol::rpc_handler::work_peer_add, true, false, mol::rpc_cost::light, false },
+	{ "work_peers", &mol::rpc_handler::work_peers, true, true, mol::rpc_cost::medium, false },
+	{ "work_peers_clear", &mol::rpc_handler::work_peers_clear, true, false, mol::rpc_cost::light, false },
+	{ "work_set", &mol::rpc_handler::work_set, true, false, mol::rpc_cost::light, false },
+	{ "work_validate", &mol::rpc_handler::work_validate, false, true, mol::rpc_cost::light, false },
+};
+
+size_t constexpr rpc_actions_size (sizeof (rpc_actions) / sizeof (rpc_actions[0]));
+
+constexpr bool rpc_name_less (char const * first_a, char const * second_a)
+{
+	return *first_a != *second_a ? static_cast<unsigned char> (*first_a) < static_cast<unsigned char> (*second_a) : *first_a != '\0' && rpc_name_less (first_a + 1, second_a + 1);
+}
+
+constexpr bool rpc_actions_sorted (size_t index_a)
+{
+	return index_a >= rpc_actions_size || (rpc_name_less (rpc_actions[index_a - 1].name, rpc_actions[index_a].name) && rpc_actions_sorted (index_a + 1));
+}
+
+static_assert (rpc_actions_sorted (1), "RPC actions must be sorted by name");
+static_assert (rpc_actions_size == mol::rpc_action_stats::actions, "RPC action stats must cover every action");
+
+char const * rpc_cost_name (mol::rpc_cost cost_a)
+{
+	char const * result ("");
+	switch (cost_a)
+	{
+		case mol::rpc_cost::light:
+			result = "light";
+			break;
+		case mol::rpc_cost::medium:
+			result = "medium";
+			break;
+		case mol::rpc_cost::heavy:
+			result = "heavy";
+			break;
+	}
+	return result;
+}
+
+/** Index of the action in rpc_actions, rpc_actions_size if there's no such action */
+size_t rpc_action_find (std::string const & action_a)
+{
+	auto existing (std::lower_bound (std::begin (rpc_actions), std::end (rpc_actions), action_a, [](rpc_action const & entry_a, std::string const & name_a) {
+		return std::strcmp (entry_a.name, name_a.c_str ()) < 0;
+	}));
+	auto result (static_cast<size_t> (existing - std::begin (rpc_actions)));
+	if (existing != std::end (rpc_actions) && action_a != existing->name)
+	{
+		result = rpc_actions_size;
+	}
+	return result;
+}
+
+/**
+ * Takes one of the heavy request slots until the response is sent, light and medium requests are always admitted.
+ * Asynchronous handlers answer after process_request returns, their response callbacks share the admission and complete it.
+ */
+class rpc_admission
+{
+public:
+	rpc_admission (mol::rpc & rpc_a, size_t action_a, mol::rpc_cost cost_a) :
+	rpc (rpc_a),
+	action (action_a),
+	counted (cost_a == mol::rpc_cost::heavy),
+	admitted (!counted || ++rpc.heavy_requests <= rpc.config.heavy_request_limit || rpc.config.heavy_request_limit == 0),
+	start (std::chrono::steady_clock::now ())
+	{
+		completed.clear ();
+	}
+	~rpc_admission ()
+	{
+		release ();
+	}
+	// Record how long the request took to answer and give back its slot, only the first response counts
+	void complete ()
+	{
+		if (!completed.test_and_set ())
+		{
+			rpc.action_stats.add (action, std::chrono::steady_clock::now () - start);
+			release ();
+		}
+	}
+	// Give back the slot without timing the request, for requests that are rejected or never answered
+	void release ()
+	{
+		if (counted.exchange (false))
+		{
+			--rpc.heavy_requests;
+		}
+	}
+	mol::rpc & rpc;
+	size_t action;
+	std::atomic<bool> counted;
+	bool admitted;
+	std::chrono::steady_clock::time_point start;
+	std::atomic_flag completed;
+};
 }
 
 void mol::rpc_handler::account_balance ()
@@ -232,10 +811,12 @@ void mol::rpc_handler::account_balance ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		auto balance (node.balance_pending (account));
+		read_transaction transaction (*this);
+		auto balance (node.ledger.account_balance (transaction, account));
+		auto pending (node.ledger.account_pending (transaction, account));
 		boost::property_tree::ptree response_l;
-		response_l.put ("balance", balance.first.convert_to<std::string> ());
-		response_l.put ("pending", balance.second.convert_to<std::string> ());
+		response_l.put ("balance", balance.convert_to<std::string> ());
+		response_l.put ("pending", pending.convert_to<std::string> ());
 		response (response_l);
 	}
 	else
@@ -251,7 +832,7 @@ void mol::rpc_handler::account_block_count ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		mol::account_info info;
 		if (!node.store.account_get (transaction, account, info))
 		{
@@ -338,7 +919,7 @@ void mol::rpc_handler::account_info ()
 		const bool representative = request.get<bool> ("representative", false);
 		const bool weight = request.get<bool> ("weight", false);
 		const bool pending = request.get<bool> ("pending", false);
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		mol::account_info info;
 		if (!node.store.account_get (transaction, account, info))
 		{
@@ -359,7 +940,7 @@ void mol::rpc_handler::account_info ()
 			}
 			if (weight)
 			{
-				auto account_weight (node.ledger.weight (transaction, account));
+				auto account_weight (transaction.weight (account));
 				response_l.put ("weight", account_weight.convert_to<std::string> ());
 			}
 			if (pending)
@@ -409,7 +990,7 @@ void mol::rpc_handler::account_list ()
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree accounts;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			for (auto i (existing->second->store.begin (transaction)), j (existing->second->store.end ()); i != j; ++i)
 			{
 				boost::property_tree::ptree entry;
@@ -559,7 +1140,7 @@ void mol::rpc_handler::account_representative ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		mol::account_info info;
 		auto error (node.store.account_get (transaction, account, info));
 		if (!error)
@@ -668,7 +1249,8 @@ void mol::rpc_handler::account_weight ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		auto balance (node.weight (account));
+		read_transaction transaction (*this);
+		auto balance (transaction.weight (account));
 		boost::property_tree::ptree response_l;
 		response_l.put ("weight", balance.convert_to<std::string> ());
 		response (response_l);
@@ -683,6 +1265,7 @@ void mol::rpc_handler::accounts_balances ()
 {
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree balances;
+	read_transaction transaction (*this);
 	for (auto & accounts : request.get_child ("accounts"))
 	{
 		std::string account_text = accounts.second.data ();
@@ -691,9 +1274,10 @@ void mol::rpc_handler::accounts_balances ()
 		if (!error)
 		{
 			boost::property_tree::ptree entry;
-			auto balance (node.balance_pending (account));
-			entry.put ("balance", balance.first.convert_to<std::string> ());
-			entry.put ("pending", balance.second.convert_to<std::string> ());
+			auto balance (node.ledger.account_balance (transaction, account));
+			auto pending (node.ledger.account_pending (transaction, account));
+			entry.put ("balance", balance.convert_to<std::string> ());
+			entry.put ("pending", pending.convert_to<std::string> ());
 			balances.push_back (std::make_pair (account.to_account (), entry));
 		}
 		else
@@ -763,7 +1347,7 @@ void mol::rpc_handler::accounts_frontiers ()
 {
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree frontiers;
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	for (auto & accounts : request.get_child ("accounts"))
 	{
 		std::string account_text = accounts.second.data ();
@@ -811,7 +1395,7 @@ void mol::rpc_handler::accounts_pending ()
 	const bool source = request.get<bool> ("source", false);
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree pending;
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	for (auto & accounts : request.get_child ("accounts"))
 	{
 		std::string account_text = accounts.second.data ();
@@ -861,16 +1445,80 @@ void mol::rpc_handler::accounts_pending ()
 
 void mol::rpc_handler::available_supply ()
 {
-	auto genesis_balance (node.balance (mol::genesis_account)); // Cold storage genesis
-	auto landing_balance (node.balance (mol::account ("059F68AAB29DE0D3A27443625C7EA9CDDB6517A8B76FE37727EF6A4D76832AD5"))); // Active unavailable account
-	auto faucet_balance (node.balance (mol::account ("8E319CE6F3025E5B2DF66DA7AB1467FE48F1679C13DD43BFDB29FA2E9FC40D3B"))); // Faucet account
-	auto burned_balance ((node.balance_pending (mol::account (0))).second); // Burning 0 account
+	read_transaction transaction (*this);
+	auto genesis_balance (node.ledger.account_balance (transaction, mol::genesis_account)); // Cold storage genesis
+	auto landing_balance (node.ledger.account_balance (transaction, mol::account ("059F68AAB29DE0D3A27443625C7EA9CDDB6517A8B76FE37727EF6A4D76832AD5"))); // Active unavailable account
+	auto faucet_balance (node.ledger.account_balance (transaction, mol::account ("8E319CE6F3025E5B2DF66DA7AB1467FE48F1679C13DD43BFDB29FA2E9FC40D3B"))); // Faucet account
+	auto burned_balance (node.ledger.account_pending (transaction, mol::account (0))); // Burning 0 account
 	auto available (mol::genesis_amount - genesis_balance - landing_balance - faucet_balance - burned_balance);
 	boost::property_tree::ptree response_l;
 	response_l.put ("available", available.convert_to<std::string> ());
 	response (response_l);
 }
 
+void mol::rpc_handler::batch ()
+{
+	auto requests_l (request.get_child_optional ("requests"));
+	if (requests_l)
+	{
+		if (!batched)
+		{
+			const bool parallel = request.get<bool> ("parallel", false);
+			auto batch_l (std::make_shared<rpc_batch> (requests_l->size (), response_body));
+			std::vector<std::shared_ptr<mol::rpc_handler>> handlers;
+			size_t index (0);
+			for (auto & i : *requests_l)
+			{
+				std::stringstream ostream;
+				boost::property_tree::write_json (ostream, i.second);
+				auto response_l ([batch_l, index](boost::property_tree::ptree const & tree_a) {
+					std::stringstream ostream;
+					boost::property_tree::write_json (ostream, tree_a);
+					batch_l->complete (index, ostream.str ());
+				});
+				auto response_body_l ([batch_l, index](std::string && body_a) {
+					batch_l->complete (index, std::move (body_a));
+				});
+				handlers.push_back (std::make_shared<mol::rpc_handler> (node, rpc, ostream.str (), response_l, response_body_l));
+				handlers.back ()->batched = true;
+				++index;
+			}
+			if (handlers.empty ())
+			{
+				batch_l->finish ();
+			}
+			else if (!parallel)
+			{
+				// Every request reads the same snapshot and the transaction is set up once
+				mol::transaction transaction (node.store.environment, nullptr, false);
+				for (auto & i : handlers)
+				{
+					i->batch_transaction = transaction;
+					i->process_request ();
+				}
+			}
+			else
+			{
+				// LMDB transactions can't be shared across threads, so parallel requests each read their own
+				for (auto & i : handlers)
+				{
+					node.background ([i]() {
+						i->process_request ();
+					});
+				}
+			}
+		}
+		else
+		{
+			error_response (response, "Batches can't be nested");
+		}
+	}
+	else
+	{
+		error_response (response, "Missing requests");
+	}
+}
+
 void mol::rpc_handler::block ()
 {
 	std::string hash_text (request.get<std::string> ("hash"));
@@ -878,7 +1526,7 @@ void mol::rpc_handler::block ()
 	auto error (hash.decode_hex (hash_text));
 	if (!error)
 	{
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		auto block (node.store.block_get (transaction, hash));
 		if (block != nullptr)
 		{
@@ -930,7 +1578,7 @@ void mol::rpc_handler::blocks ()
 	std::vector<std::string> hashes;
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree blocks;
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	for (boost::property_tree::ptree::value_type & hashes : request.get_child ("hashes"))
 	{
 		std::string hash_text = hashes.second.data ();
@@ -967,7 +1615,7 @@ void mol::rpc_handler::blocks_info ()
 	std::vector<std::string> hashes;
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree blocks;
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	for (boost::property_tree::ptree::value_type & hashes : request.get_child ("hashes"))
 	{
 		std::string hash_text = hashes.second.data ();
@@ -1037,7 +1685,7 @@ void mol::rpc_handler::block_account ()
 	mol::block_hash hash;
 	if (!hash.decode_hex (hash_text))
 	{
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		if (node.store.block_exists (transaction, hash))
 		{
 			boost::property_tree::ptree response_l;
@@ -1058,23 +1706,24 @@ void mol::rpc_handler::block_account ()
 
 void mol::rpc_handler::block_count ()
 {
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	boost::property_tree::ptree response_l;
-	response_l.put ("count", std::to_string (node.store.block_count (transaction).sum ()));
+	response_l.put ("count", std::to_string (transaction.block_count ().sum ()));
 	response_l.put ("unchecked", std::to_string (node.store.unchecked_count (transaction)));
 	response (response_l);
 }
 
 void mol::rpc_handler::block_count_type ()
 {
-	mol::transaction transaction (node.store.environment, nullptr, false);
-	mol::block_counts count (node.store.block_count (transaction));
+	read_transaction transaction (*this);
+	mol::block_counts count (transaction.block_count ());
 	boost::property_tree::ptree response_l;
 	response_l.put ("send", std::to_string (count.send));
 	response_l.put ("receive", std::to_string (count.receive));
 	response_l.put ("open", std::to_string (count.open));
 	response_l.put ("change", std::to_string (count.change));
 	response_l.put ("state", std::to_string (count.state));
+	response_l.put ("astate", std::to_string (count.astate));
 	response (response_l);
 }
 
@@ -1162,7 +1811,7 @@ void mol::rpc_handler::block_create ()
 			auto existing (node.wallets.items.find (wallet));
 			if (existing != node.wallets.items.end ())
 			{
-				mol::transaction transaction (node.store.environment, nullptr, false);
+				read_transaction transaction (*this);
 				auto unlock_check (existing->second->store.valid_password (transaction));
 				if (unlock_check)
 				{
@@ -1241,14 +1890,14 @@ void mol::rpc_handler::block_create ()
 			// Fetching account balance & previous for send blocks (if aren't given directly)
 			if (!previous_text.is_initialized () && !balance_text.is_initialized ())
 			{
-				mol::transaction transaction (node.store.environment, nullptr, false);
+				read_transaction transaction (*this);
 				previous = node.ledger.latest (transaction, pub);
 				balance = node.ledger.account_balance (transaction, pub);
 			}
 			// Double check current balance if previous block is specified
 			else if (previous_text.is_initialized () && balance_text.is_initialized () && type == "send")
 			{
-				mol::transaction transaction (node.store.environment, nullptr, false);
+				read_transaction transaction (*this);
 				if (node.store.block_exists (transaction, previous) && node.store.block_balance (transaction, previous) != balance.number ())
 				{
 					error_response (response, "Balance mismatch for previous block");
@@ -1423,7 +2072,7 @@ void mol::rpc_handler::successors ()
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree blocks;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			while (!block.is_zero () && blocks.size () < count)
 			{
 				auto block_l (node.store.block_get (transaction, block));
@@ -1500,7 +2149,7 @@ void mol::rpc_handler::chain ()
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree blocks;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			while (!block.is_zero () && blocks.size () < count)
 			{
 				auto block_l (node.store.block_get (transaction, block));
@@ -1535,7 +2184,7 @@ void mol::rpc_handler::confirmation_history ()
 	boost::property_tree::ptree response_l;
 	boost::property_tree::ptree elections;
 	{
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		std::lock_guard<std::mutex> lock (node.active.mutex);
 		for (auto i (node.active.confirmed.begin ()), n (node.active.confirmed.end ()); i != n; ++i)
 		{
@@ -1556,9 +2205,10 @@ void mol::rpc_handler::delegators ()
 	auto error (account.decode_account (account_text));
 	if (!error)
 	{
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree delegators;
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		std::string body_l;
+		mol::json_writer response_l (body_l, response_chunk);
+		response_l.begin_object ("delegators");
+		read_transaction transaction (*this);
 		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
 		{
 			mol::account_info info (i->second);
@@ -1568,11 +2218,12 @@ void mol::rpc_handler::delegators ()
 			{
 				std::string balance;
 				mol::uint128_union (info.balance).encode_dec (balance);
-				delegators.put (mol::account (i->first.uint256 ()).to_account (), balance);
+				response_l.put (mol::account (i->first.uint256 ()).to_account (), balance);
 			}
 		}
-		response_l.add_child ("delegators", delegators);
-		response (response_l);
+		response_l.end ();
+		response_l.finish ();
+		response_body (std::move (body_l));
 	}
 	else
 	{
@@ -1588,7 +2239,7 @@ void mol::rpc_handler::delegators_count ()
 	if (!error)
 	{
 		uint64_t count (0);
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		for (auto i (node.store.latest_begin (transaction)), n (node.store.latest_end ()); i != n; ++i)
 		{
 			mol::account_info info (i->second);
@@ -1656,15 +2307,18 @@ void mol::rpc_handler::frontiers ()
 		uint64_t count;
 		if (!decode_unsigned (count_text, count))
 		{
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree frontiers;
-			mol::transaction transaction (node.store.environment, nullptr, false);
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && frontiers.size () < count; ++i)
+			std::string body_l;
+			mol::json_writer response_l (body_l, response_chunk);
+			response_l.begin_object ("frontiers");
+			read_transaction transaction (*this);
+			uint64_t written (0);
+			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && written < count; ++i, ++written)
 			{
-				frontiers.put (mol::account (i->first.uint256 ()).to_account (), mol::account_info (i->second).head.to_string ());
+				response_l.put (mol::account (i->first.uint256 ()).to_account (), mol::account_info (i->second).head.to_string ());
 			}
-			response_l.add_child ("frontiers", frontiers);
-			response (response_l);
+			response_l.end ();
+			response_l.finish ();
+			response_body (std::move (body_l));
 		}
 		else
 		{
@@ -1679,7 +2333,7 @@ void mol::rpc_handler::frontiers ()
 
 void mol::rpc_handler::frontier_count ()
 {
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	auto size (node.store.frontier_count (transaction));
 	boost::property_tree::ptree response_l;
 	response_l.put ("count", std::to_string (size));
@@ -1691,7 +2345,7 @@ namespace
 class history_visitor : public mol::block_visitor
 {
 public:
-	history_visitor (mol::rpc_handler & handler_a, bool raw_a, mol::transaction & transaction_a, boost::property_tree::ptree & tree_a, mol::block_hash const & hash_a) :
+	history_visitor (mol::rpc_handler & handler_a, bool raw_a, MDB_txn * transaction_a, boost::property_tree::ptree & tree_a, mol::block_hash const & hash_a) :
 	handler (handler_a),
 	raw (raw_a),
 	transaction (transaction_a),
@@ -1807,7 +2461,7 @@ public:
 	}
 	mol::rpc_handler & handler;
 	bool raw;
-	mol::transaction & transaction;
+	MDB_txn * transaction;
 	boost::property_tree::ptree & tree;
 	mol::block_hash const & hash;
 };
@@ -1821,7 +2475,7 @@ void mol::rpc_handler::account_history ()
 	auto error (false);
 	mol::block_hash hash;
 	auto head_str (request.get_optional<std::string> ("head"));
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	if (head_str)
 	{
 		error = hash.decode_hex (*head_str);
@@ -1857,11 +2511,18 @@ void mol::rpc_handler::account_history ()
 			auto offset_text (request.get_optional<std::string> ("offset"));
 			if (!offset_text || !decode_unsigned (*offset_text, offset))
 			{
+				uint64_t height_start (0);
+				auto height_start_text (request.get_optional<std::string> ("height_start"));
+				if (height_start_text)
+				{
+					error = decode_unsigned (*height_start_text, height_start);
+				}
 				boost::property_tree::ptree response_l;
 				boost::property_tree::ptree history;
 				if (!error)
 				{
 					response_l.put ("account", account_text);
+					history_seek (transaction, hash, offset, height_start);
 					auto block (node.store.block_get (transaction, hash));
 					while (block != nullptr && count > 0)
 					{
@@ -1898,7 +2559,7 @@ void mol::rpc_handler::account_history ()
 				}
 				else
 				{
-					error_response (response, "Failed to decode head block hash");
+					error_response (response, "Invalid height_start");
 				}
 			}
 			else
@@ -1913,6 +2574,38 @@ void mol::rpc_handler::account_history ()
 	}
 }
 
+/**
+ * Move head_a to the first block a history request returns, through the ledger height index.
+ * height_a, when non-zero, selects the first height returned, otherwise offset_a blocks below head_a are skipped.
+ * Leaves the remaining offset to be walked when the chain isn't indexed at that height.
+ */
+void mol::rpc_handler::history_seek (MDB_txn * transaction_a, mol::block_hash & head_a, uint64_t & offset_a, uint64_t height_a)
+{
+	mol::block_sideband sideband;
+	if (!node.ledger.sideband_get (transaction_a, head_a, sideband))
+	{
+		if (height_a != 0)
+		{
+			offset_a = sideband.height > height_a ? sideband.height - height_a : 0;
+		}
+		if (offset_a >= sideband.height)
+		{
+			head_a.clear ();
+			offset_a = 0;
+		}
+		else if (offset_a > 0 && !node.ledger.block_at_height (transaction_a, head_a, sideband.height - offset_a, head_a))
+		{
+			offset_a = 0;
+		}
+	}
+}
+
+void mol::rpc_handler::history ()
+{
+	request.put ("head", request.get<std::string> ("hash"));
+	account_history ();
+}
+
 void mol::rpc_handler::keepalive ()
 {
 	if (rpc.config.enable_control)
@@ -1972,125 +2665,109 @@ void mol::rpc_handler::ledger ()
 {
 	if (rpc.config.enable_control)
 	{
+		auto error (false);
 		mol::account start (0);
 		uint64_t count (std::numeric_limits<uint64_t>::max ());
 		boost::optional<std::string> account_text (request.get_optional<std::string> ("account"));
 		if (account_text.is_initialized ())
 		{
-			auto error (start.decode_account (account_text.get ()));
+			error = start.decode_account (account_text.get ());
 			if (error)
 			{
 				error_response (response, "Invalid starting account");
 			}
 		}
 		boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
-		if (count_text.is_initialized ())
+		if (!error && count_text.is_initialized ())
 		{
-			auto error_count (decode_unsigned (count_text.get (), count));
-			if (error_count)
+			error = decode_unsigned (count_text.get (), count);
+			if (error)
 			{
 				error_response (response, "Invalid count limit");
 			}
 		}
-		uint64_t modified_since (0);
-		boost::optional<std::string> modified_since_text (request.get_optional<std::string> ("modified_since"));
-		if (modified_since_text.is_initialized ())
-		{
-			modified_since = strtoul (modified_since_text.get ().c_str (), NULL, 10);
-		}
-		const bool sorting = request.get<bool> ("sorting", false);
-		const bool representative = request.get<bool> ("representative", false);
-		const bool weight = request.get<bool> ("weight", false);
-		const bool pending = request.get<bool> ("pending", false);
-		boost::property_tree::ptree response_a;
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree accounts;
-		mol::transaction transaction (node.store.environment, nullptr, false);
-		if (!sorting) // Simple
-		{
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && accounts.size () < count; ++i)
-			{
-				mol::account_info info (i->second);
-				if (info.modified >= modified_since)
-				{
-					mol::account account (i->first.uint256 ());
-					boost::property_tree::ptree response_l;
-					response_l.put ("frontier", info.head.to_string ());
-					response_l.put ("open_block", info.open_block.to_string ());
-					response_l.put ("representative_block", info.rep_block.to_string ());
-					std::string balance;
-					mol::uint128_union (info.balance).encode_dec (balance);
-					response_l.put ("balance", balance);
-					response_l.put ("modified_timestamp", std::to_string (info.modified));
-					response_l.put ("block_count", std::to_string (info.block_count));
-					if (representative)
-					{
-						auto block (node.store.block_get (transaction, info.rep_block));
-						assert (block != nullptr);
-						response_l.put ("representative", block->representative ().to_account ());
-					}
-					if (weight)
-					{
-						auto account_weight (node.ledger.weight (transaction, account));
-						response_l.put ("weight", account_weight.convert_to<std::string> ());
-					}
-					if (pending)
-					{
-						auto account_pending (node.ledger.account_pending (transaction, account));
-						response_l.put ("pending", account_pending.convert_to<std::string> ());
-					}
-					accounts.push_back (std::make_pair (account.to_account (), response_l));
-				}
-			}
-		}
-		else // Sorting
+		if (!error)
 		{
-			std::vector<std::pair<mol::uint128_union, mol::account>> ledger_l;
-			for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
-			{
-				mol::account_info info (i->second);
-				mol::uint128_union balance (info.balance);
-				if (info.modified >= modified_since)
-				{
-					ledger_l.push_back (std::make_pair (balance, mol::account (i->first.uint256 ())));
-				}
-			}
-			std::sort (ledger_l.begin (), ledger_l.end ());
-			std::reverse (ledger_l.begin (), ledger_l.end ());
-			mol::account_info info;
-			for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && accounts.size () < count; ++i)
+			uint64_t modified_since (0);
+			boost::optional<std::string> modified_since_text (request.get_optional<std::string> ("modified_since"));
+			if (modified_since_text.is_initialized ())
 			{
-				node.store.account_get (transaction, i->second, info);
-				mol::account account (i->second);
-				response_l.put ("frontier", info.head.to_string ());
-				response_l.put ("open_block", info.open_block.to_string ());
-				response_l.put ("representative_block", info.rep_block.to_string ());
+				modified_since = strtoul (modified_since_text.get ().c_str (), NULL, 10);
+			}
+			const bool sorting = request.get<bool> ("sorting", false);
+			const bool representative = request.get<bool> ("representative", false);
+			const bool weight = request.get<bool> ("weight", false);
+			const bool pending = request.get<bool> ("pending", false);
+			std::string body_l;
+			mol::json_writer response_l (body_l, response_chunk);
+			response_l.begin_object ("accounts");
+			read_transaction transaction (*this);
+			auto write_account ([&](mol::account const & account_a, mol::account_info const & info_a) {
+				response_l.begin_object (account_a.to_account ());
+				response_l.put ("frontier", info_a.head.to_string ());
+				response_l.put ("open_block", info_a.open_block.to_string ());
+				response_l.put ("representative_block", info_a.rep_block.to_string ());
 				std::string balance;
-				(i->first).encode_dec (balance);
+				mol::uint128_union (info_a.balance).encode_dec (balance);
 				response_l.put ("balance", balance);
-				response_l.put ("modified_timestamp", std::to_string (info.modified));
-				response_l.put ("block_count", std::to_string (info.block_count));
+				response_l.put ("modified_timestamp", std::to_string (info_a.modified));
+				response_l.put ("block_count", std::to_string (info_a.block_count));
 				if (representative)
 				{
-					auto block (node.store.block_get (transaction, info.rep_block));
+					auto block (node.store.block_get (transaction, info_a.rep_block));
 					assert (block != nullptr);
 					response_l.put ("representative", block->representative ().to_account ());
 				}
 				if (weight)
 				{
-					auto account_weight (node.ledger.weight (transaction, account));
+					auto account_weight (transaction.weight (account_a));
 					response_l.put ("weight", account_weight.convert_to<std::string> ());
 				}
 				if (pending)
 				{
-					auto account_pending (node.ledger.account_pending (transaction, account));
+					auto account_pending (node.ledger.account_pending (transaction, account_a));
 					response_l.put ("pending", account_pending.convert_to<std::string> ());
 				}
-				accounts.push_back (std::make_pair (account.to_account (), response_l));
+				response_l.end ();
+			});
+			uint64_t written (0);
+			if (!sorting) // Simple
+			{
+				for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n && written < count; ++i)
+				{
+					mol::account_info info (i->second);
+					if (info.modified >= modified_since)
+					{
+						write_account (mol::account (i->first.uint256 ()), info);
+						++written;
+					}
+				}
+			}
+			else // Sorting
+			{
+				std::vector<std::pair<mol::uint128_union, mol::account>> ledger_l;
+				for (auto i (node.store.latest_begin (transaction, start)), n (node.store.latest_end ()); i != n; ++i)
+				{
+					mol::account_info info (i->second);
+					mol::uint128_union balance (info.balance);
+					if (info.modified >= modified_since)
+					{
+						ledger_l.push_back (std::make_pair (balance, mol::account (i->first.uint256 ())));
+					}
+				}
+				std::sort (ledger_l.begin (), ledger_l.end ());
+				std::reverse (ledger_l.begin (), ledger_l.end ());
+				mol::account_info info;
+				for (auto i (ledger_l.begin ()), n (ledger_l.end ()); i != n && written < count; ++i, ++written)
+				{
+					node.store.account_get (transaction, i->second, info);
+					write_account (i->second, info);
+				}
 			}
+			response_l.end ();
+			response_l.finish ();
+			response_body (std::move (body_l));
 		}
-		response_a.add_child ("accounts", accounts);
-		response (response_a);
 	}
 	else
 	{
@@ -2242,7 +2919,12 @@ void mol::rpc_handler::password_enter ()
 	}
 }
 
-void mol::rpc_handler::password_valid (bool wallet_locked = false)
+void mol::rpc_handler::password_valid ()
+{
+	password_valid (false);
+}
+
+void mol::rpc_handler::password_valid (bool wallet_locked)
 {
 	std::string wallet_text (request.get<std::string> ("wallet"));
 	mol::uint256_union wallet;
@@ -2297,63 +2979,78 @@ void mol::rpc_handler::pending ()
 	mol::account account;
 	if (!account.decode_account (account_text))
 	{
+		auto error (false);
 		uint64_t count (std::numeric_limits<uint64_t>::max ());
 		mol::uint128_union threshold (0);
 		boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 		if (count_text.is_initialized ())
 		{
-			auto error (decode_unsigned (count_text.get (), count));
+			error = decode_unsigned (count_text.get (), count);
 			if (error)
 			{
 				error_response (response, "Invalid count limit");
 			}
 		}
 		boost::optional<std::string> threshold_text (request.get_optional<std::string> ("threshold"));
-		if (threshold_text.is_initialized ())
+		if (!error && threshold_text.is_initialized ())
 		{
-			auto error_threshold (threshold.decode_dec (threshold_text.get ()));
-			if (error_threshold)
+			error = threshold.decode_dec (threshold_text.get ());
+			if (error)
 			{
 				error_response (response, "Bad threshold number");
 			}
 		}
-		const bool source = request.get<bool> ("source", false);
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree peers_l;
+		if (!error)
 		{
-			mol::transaction transaction (node.store.environment, nullptr, false);
-			mol::account end (account.number () + 1);
-			for (auto i (node.store.pending_begin (transaction, mol::pending_key (account, 0))), n (node.store.pending_begin (transaction, mol::pending_key (end, 0))); i != n && peers_l.size () < count; ++i)
+			const bool source = request.get<bool> ("source", false);
+			const bool hashes_only (threshold.is_zero () && !source);
+			std::string body_l;
+			mol::json_writer response_l (body_l, response_chunk);
+			if (hashes_only)
 			{
-				mol::pending_key key (i->first);
-				if (threshold.is_zero () && !source)
-				{
-					boost::property_tree::ptree entry;
-					entry.put ("", key.hash.to_string ());
-					peers_l.push_back (std::make_pair ("", entry));
-				}
-				else
+				response_l.begin_array ("blocks");
+			}
+			else
+			{
+				response_l.begin_object ("blocks");
+			}
+			{
+				read_transaction transaction (*this);
+				mol::account end (account.number () + 1);
+				uint64_t written (0);
+				for (auto i (node.store.pending_begin (transaction, mol::pending_key (account, 0))), n (node.store.pending_begin (transaction, mol::pending_key (end, 0))); i != n && written < count; ++i)
 				{
-					mol::pending_info info (i->second);
-					if (info.amount.number () >= threshold.number ())
+					mol::pending_key key (i->first);
+					if (hashes_only)
 					{
-						if (source)
-						{
-							boost::property_tree::ptree pending_tree;
-							pending_tree.put ("amount", info.amount.number ().convert_to<std::string> ());
-							pending_tree.put ("source", info.source.to_account ());
-							peers_l.add_child (key.hash.to_string (), pending_tree);
-						}
-						else
+						response_l.push (key.hash.to_string ());
+						++written;
+					}
+					else
+					{
+						mol::pending_info info (i->second);
+						if (info.amount.number () >= threshold.number ())
 						{
-							peers_l.put (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
+							if (source)
+							{
+								response_l.begin_object (key.hash.to_string ());
+								response_l.put ("amount", info.amount.number ().convert_to<std::string> ());
+								response_l.put ("source", info.source.to_account ());
+								response_l.end ();
+							}
+							else
+							{
+								response_l.put (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
+							}
+							++written;
 						}
 					}
 				}
 			}
+			response_l.end ();
+			response_l.finish ();
+			response_body (std::move (body_l));
 		}
-		response_l.add_child ("blocks", peers_l);
-		response (response_l);
 	}
 	else
 	{
@@ -2368,7 +3065,7 @@ void mol::rpc_handler::pending_exists ()
 	auto error (hash.decode_hex (hash_text));
 	if (!error)
 	{
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		auto block (node.store.block_get (transaction, hash));
 		if (block != nullptr)
 		{
@@ -2591,19 +3288,21 @@ void mol::rpc_handler::payment_wait ()
 void mol::rpc_handler::process ()
 {
 	std::string block_text (request.get<std::string> ("block"));
-	boost::property_tree::ptree block_l;
-	std::stringstream block_stream (block_text);
-	boost::property_tree::read_json (block_stream, block_l);
-	auto block (mol::deserialize_block_json (block_l));
+	auto block (mol::deserialize_block_json (block_text));
 	if (block != nullptr)
 	{
 		if (!mol::work_validate (*block))
 		{
 			auto hash (block->hash ());
 			node.block_arrival.add (hash);
+			{
+				// Check the signature before taking the write transaction
+				mol::transaction transaction (node.store.environment, nullptr, false);
+				node.ledger.verify_signatures (transaction, std::vector<mol::block const *> (1, block.get ()));
+			}
 			mol::process_return result;
 			{
-				mol::transaction transaction (node.store.environment, nullptr, true);
+				mol::ledger_transaction transaction (node.ledger);
 				result = node.block_processor.process_receive_one (transaction, std::move (block));
 			}
 			switch (result.code)
@@ -2888,46 +3587,51 @@ void mol::rpc_handler::receive_minimum_set ()
 void mol::rpc_handler::representatives ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
 		}
 	}
-	const bool sorting = request.get<bool> ("sorting", false);
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree representatives;
-	mol::transaction transaction (node.store.environment, nullptr, false);
-	if (!sorting) // Simple
-	{
-		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n && representatives.size () < count; ++i)
-		{
-			mol::account account (i->first.uint256 ());
-			auto amount (node.store.representation_get (transaction, account));
-			representatives.put (account.to_account (), amount.convert_to<std::string> ());
-		}
-	}
-	else // Sorting
+	if (!error)
 	{
-		std::vector<std::pair<mol::uint128_union, std::string>> representation;
-		for (auto i (node.store.representation_begin (transaction)), n (node.store.representation_end ()); i != n; ++i)
+		const bool sorting = request.get<bool> ("sorting", false);
+		std::string body_l;
+		mol::json_writer response_l (body_l, response_chunk);
+		response_l.begin_object ("representatives");
+		read_transaction transaction (*this);
+		auto weights (transaction.representation_list ());
+		uint64_t written (0);
+		if (!sorting) // Simple
 		{
-			mol::account account (i->first.uint256 ());
-			auto amount (node.store.representation_get (transaction, account));
-			representation.push_back (std::make_pair (amount, account.to_account ()));
+			for (auto i (weights.begin ()), n (weights.end ()); i != n && written < count; ++i, ++written)
+			{
+				response_l.put (i->first.to_account (), i->second.convert_to<std::string> ());
+			}
 		}
-		std::sort (representation.begin (), representation.end ());
-		std::reverse (representation.begin (), representation.end ());
-		for (auto i (representation.begin ()), n (representation.end ()); i != n && representatives.size () < count; ++i)
+		else // Sorting
 		{
-			representatives.put (i->second, (i->first).number ().convert_to<std::string> ());
+			std::vector<std::pair<mol::uint128_union, std::string>> representation;
+			representation.reserve (weights.size ());
+			for (auto & i : weights)
+			{
+				representation.push_back (std::make_pair (i.second, i.first.to_account ()));
+			}
+			std::sort (representation.begin (), representation.end ());
+			std::reverse (representation.begin (), representation.end ());
+			for (auto i (representation.begin ()), n (representation.end ()); i != n && written < count; ++i, ++written)
+			{
+				response_l.put (i->second, (i->first).number ().convert_to<std::string> ());
+			}
 		}
+		response_l.end ();
+		response_l.finish ();
+		response_body (std::move (body_l));
 	}
-	response_l.add_child ("representatives", representatives);
-	response (response_l);
 }
 
 void mol::rpc_handler::representatives_online ()
@@ -3247,7 +3951,7 @@ void mol::rpc_handler::stats ()
 	{
 		node.stats.log_samples (*sink);
 	}
-	else
+	else if (type != "astate" && type != "rpc")
 	{
 		error = true;
 		error_response (response, "Invalid or missing type argument");
@@ -3255,7 +3959,42 @@ void mol::rpc_handler::stats ()
 
 	if (!error)
 	{
-		response (*static_cast<boost::property_tree::ptree *> (sink->to_object ()));
+		if (type == "astate")
+		{
+			// Time spent per step of astate block processing, kept by the ledger
+			boost::property_tree::ptree response_l;
+			for (size_t i (0); i < mol::astate_timing::steps; ++i)
+			{
+				auto step (static_cast<mol::astate_timing::step> (i));
+				boost::property_tree::ptree entry;
+				entry.put ("count", std::to_string (node.ledger.astate_timing.count (step)));
+				entry.put ("nanoseconds", std::to_string (node.ledger.astate_timing.nanoseconds (step)));
+				response_l.add_child (mol::astate_timing::name (step), entry);
+			}
+			response (response_l);
+		}
+		else if (type == "rpc")
+		{
+			// Requests handled and refused per action, with the time spent in their handlers
+			boost::property_tree::ptree response_l;
+			for (size_t i (0); i < rpc_actions_size; ++i)
+			{
+				boost::property_tree::ptree entry;
+				entry.put ("count", std::to_string (rpc.action_stats.count (i)));
+				entry.put ("rejected", std::to_string (rpc.action_stats.rejected (i)));
+				entry.put ("microseconds", std::to_string (rpc.action_stats.microseconds (i)));
+				entry.put ("cost", rpc_cost_name (rpc_actions[i].cost));
+				entry.put ("control", rpc_actions[i].control ? "1" : "0");
+				entry.put ("read_only", rpc_actions[i].read_only ? "1" : "0");
+				response_l.push_back (std::make_pair (rpc_actions[i].name, entry));
+			}
+			response_l.put ("heavy_in_progress", std::to_string (rpc.heavy_requests.load ()));
+			response (response_l);
+		}
+		else
+		{
+			response (*static_cast<boost::property_tree::ptree *> (sink->to_object ()));
+		}
 	}
 }
 
@@ -3278,28 +4017,52 @@ void mol::rpc_handler::stop ()
 void mol::rpc_handler::unchecked ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
 		}
 	}
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree unchecked;
-	mol::transaction transaction (node.store.environment, nullptr, false);
-	for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
+	if (!error)
 	{
-		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		auto block (mol::deserialize_block (stream));
+		std::string body_l;
+		mol::json_writer response_l (body_l, response_chunk);
+		response_l.begin_object ("blocks");
+		read_transaction transaction (*this);
+		std::vector<std::unique_ptr<mol::block>> blocks;
+		std::vector<mol::block const *> blocks_l;
+		std::vector<mol::block_hash> hashes;
 		std::string contents;
-		block->serialize_json (contents);
-		unchecked.put (block->hash ().to_string (), contents);
+		uint64_t written (0);
+		auto i (node.store.unchecked_begin (transaction));
+		auto n (node.store.unchecked_end ());
+		while (i != n && written < count)
+		{
+			// Hash a batch at a time so memory stays bounded while the output streams
+			blocks.clear ();
+			blocks_l.clear ();
+			for (; i != n && written + blocks.size () < count && blocks.size () < unchecked_batch; ++i)
+			{
+				mol::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+				blocks.push_back (mol::deserialize_block (stream));
+				blocks_l.push_back (blocks.back ().get ());
+			}
+			mol::hash_blocks (blocks_l, hashes);
+			for (size_t j (0), m (blocks.size ()); j < m; ++j)
+			{
+				blocks[j]->serialize_json (contents);
+				response_l.put (hashes[j].to_string (), contents);
+			}
+			written += blocks.size ();
+		}
+		response_l.end ();
+		response_l.finish ();
+		response_body (std::move (body_l));
 	}
-	response_l.add_child ("blocks", unchecked);
-	response (response_l);
 }
 
 void mol::rpc_handler::unchecked_clear ()
@@ -3326,17 +4089,60 @@ void mol::rpc_handler::unchecked_get ()
 	if (!error)
 	{
 		boost::property_tree::ptree response_l;
-		mol::transaction transaction (node.store.environment, nullptr, false);
+		read_transaction transaction (*this);
 		for (auto i (node.store.unchecked_begin (transaction)), n (node.store.unchecked_end ()); i != n; ++i)
 		{
-			mol::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-			auto block (mol::deserialize_block (stream));
-			if (block->hash () == hash)
+			auto data (reinterpret_cast<uint8_t const *> (i->second.data ()));
+			auto size (i->second.size ());
+			// Only the matching entry is deserialized, common block types are hashed in place
+			auto view_error (true);
+			mol::block_hash hash_l;
+			if (size > 0)
 			{
-				std::string contents;
-				block->serialize_json (contents);
-				response_l.put ("contents", contents);
-				break;
+				switch (static_cast<mol::block_type> (data[0]))
+				{
+					case mol::block_type::send:
+					{
+						mol::send_block_view view (view_error, data + 1, size - 1);
+						if (!view_error)
+						{
+							hash_l = view.hash ();
+						}
+						break;
+					}
+					case mol::block_type::state:
+					{
+						mol::state_block_view view (view_error, data + 1, size - 1);
+						if (!view_error)
+						{
+							hash_l = view.hash ();
+						}
+						break;
+					}
+					case mol::block_type::astate:
+					{
+						mol::astate_block_view view (view_error, data + 1, size - 1);
+						if (!view_error)
+						{
+							hash_l = view.hash ();
+						}
+						break;
+					}
+					default:
+						break;
+				}
+			}
+			if (view_error || hash_l == hash)
+			{
+				mol::bufferstream stream (data, size);
+				auto block (mol::deserialize_block (stream));
+				if (block != nullptr && block->hash () == hash)
+				{
+					std::string contents;
+					block->serialize_json (contents);
+					response_l.put ("contents", contents);
+					break;
+				}
 			}
 		}
 		if (!response_l.empty ())
@@ -3358,41 +4164,67 @@ void mol::rpc_handler::unchecked_keys ()
 {
 	uint64_t count (std::numeric_limits<uint64_t>::max ());
 	mol::uint256_union key (0);
+	auto error (false);
 	boost::optional<std::string> count_text (request.get_optional<std::string> ("count"));
 	if (count_text.is_initialized ())
 	{
-		auto error (decode_unsigned (count_text.get (), count));
+		error = decode_unsigned (count_text.get (), count);
 		if (error)
 		{
 			error_response (response, "Invalid count limit");
 		}
 	}
 	boost::optional<std::string> hash_text (request.get_optional<std::string> ("key"));
-	if (hash_text.is_initialized ())
+	if (!error && hash_text.is_initialized ())
 	{
-		auto error_hash (key.decode_hex (hash_text.get ()));
-		if (error_hash)
+		error = key.decode_hex (hash_text.get ());
+		if (error)
 		{
 			error_response (response, "Bad key hash number");
 		}
 	}
-	boost::property_tree::ptree response_l;
-	boost::property_tree::ptree unchecked;
-	mol::transaction transaction (node.store.environment, nullptr, false);
-	for (auto i (node.store.unchecked_begin (transaction, key)), n (node.store.unchecked_end ()); i != n && unchecked.size () < count; ++i)
+	if (!error)
 	{
-		boost::property_tree::ptree entry;
-		mol::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
-		auto block (mol::deserialize_block (stream));
+		std::string body_l;
+		mol::json_writer response_l (body_l, response_chunk);
+		response_l.begin_array ("unchecked");
+		read_transaction transaction (*this);
+		std::vector<mol::block_hash> keys;
+		std::vector<std::unique_ptr<mol::block>> blocks;
+		std::vector<mol::block const *> blocks_l;
+		std::vector<mol::block_hash> hashes;
 		std::string contents;
-		block->serialize_json (contents);
-		entry.put ("key", mol::block_hash (i->first.uint256 ()).to_string ());
-		entry.put ("hash", block->hash ().to_string ());
-		entry.put ("contents", contents);
-		unchecked.push_back (std::make_pair ("", entry));
+		uint64_t written (0);
+		auto i (node.store.unchecked_begin (transaction, key));
+		auto n (node.store.unchecked_end ());
+		while (i != n && written < count)
+		{
+			keys.clear ();
+			blocks.clear ();
+			blocks_l.clear ();
+			for (; i != n && written + blocks.size () < count && blocks.size () < unchecked_batch; ++i)
+			{
+				mol::bufferstream stream (reinterpret_cast<uint8_t const *> (i->second.data ()), i->second.size ());
+				keys.push_back (i->first.uint256 ());
+				blocks.push_back (mol::deserialize_block (stream));
+				blocks_l.push_back (blocks.back ().get ());
+			}
+			mol::hash_blocks (blocks_l, hashes);
+			for (size_t j (0), m (blocks.size ()); j < m; ++j)
+			{
+				blocks[j]->serialize_json (contents);
+				response_l.begin_object ();
+				response_l.put ("key", keys[j].to_string ());
+				response_l.put ("hash", hashes[j].to_string ());
+				response_l.put ("contents", contents);
+				response_l.end ();
+			}
+			written += blocks.size ();
+		}
+		response_l.end ();
+		response_l.finish ();
+		response_body (std::move (body_l));
 	}
-	response_l.add_child ("unchecked", unchecked);
-	response (response_l);
 }
 
 void mol::rpc_handler::version ()
@@ -3531,7 +4363,7 @@ void mol::rpc_handler::wallet_balance_total ()
 		{
 			mol::uint128_t balance (0);
 			mol::uint128_t pending (0);
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
 			{
 				mol::account account (i->first.uint256 ());
@@ -3576,7 +4408,7 @@ void mol::rpc_handler::wallet_balances ()
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree balances;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
 			{
 				mol::account account (i->first.uint256 ());
@@ -3681,7 +4513,7 @@ void mol::rpc_handler::wallet_contains ()
 			auto existing (node.wallets.items.find (wallet));
 			if (existing != node.wallets.items.end ())
 			{
-				mol::transaction transaction (node.store.environment, nullptr, false);
+				read_transaction transaction (*this);
 				auto exists (existing->second->store.find (transaction, account) != existing->second->store.end ());
 				boost::property_tree::ptree response_l;
 				response_l.put ("exists", exists ? "1" : "0");
@@ -3770,7 +4602,7 @@ void mol::rpc_handler::wallet_export ()
 		auto existing (node.wallets.items.find (wallet));
 		if (existing != node.wallets.items.end ())
 		{
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			std::string json;
 			existing->second->store.serialize_json (transaction, json);
 			boost::property_tree::ptree response_l;
@@ -3800,7 +4632,7 @@ void mol::rpc_handler::wallet_frontiers ()
 		{
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree frontiers;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
 			{
 				mol::account account (i->first.uint256 ());
@@ -3834,7 +4666,7 @@ void mol::rpc_handler::wallet_key_valid ()
 		auto existing (node.wallets.items.find (wallet));
 		if (existing != node.wallets.items.end ())
 		{
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			auto valid (existing->second->store.valid_password (transaction));
 			boost::property_tree::ptree response_l;
 			response_l.put ("valid", valid ? "1" : "0");
@@ -3870,9 +4702,10 @@ void mol::rpc_handler::wallet_ledger ()
 		auto existing (node.wallets.items.find (wallet));
 		if (existing != node.wallets.items.end ())
 		{
-			boost::property_tree::ptree response_l;
-			boost::property_tree::ptree accounts;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			std::string body_l;
+			mol::json_writer response_l (body_l, response_chunk);
+			response_l.begin_object ("accounts");
+			read_transaction transaction (*this);
 			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
 			{
 				mol::account account (i->first.uint256 ());
@@ -3881,37 +4714,38 @@ void mol::rpc_handler::wallet_ledger ()
 				{
 					if (info.modified >= modified_since)
 					{
-						boost::property_tree::ptree entry;
-						entry.put ("frontier", info.head.to_string ());
-						entry.put ("open_block", info.open_block.to_string ());
-						entry.put ("representative_block", info.rep_block.to_string ());
+						response_l.begin_object (account.to_account ());
+						response_l.put ("frontier", info.head.to_string ());
+						response_l.put ("open_block", info.open_block.to_string ());
+						response_l.put ("representative_block", info.rep_block.to_string ());
 						std::string balance;
 						mol::uint128_union (info.balance).encode_dec (balance);
-						entry.put ("balance", balance);
-						entry.put ("modified_timestamp", std::to_string (info.modified));
-						entry.put ("block_count", std::to_string (info.block_count));
+						response_l.put ("balance", balance);
+						response_l.put ("modified_timestamp", std::to_string (info.modified));
+						response_l.put ("block_count", std::to_string (info.block_count));
 						if (representative)
 						{
 							auto block (node.store.block_get (transaction, info.rep_block));
 							assert (block != nullptr);
-							entry.put ("representative", block->representative ().to_account ());
+							response_l.put ("representative", block->representative ().to_account ());
 						}
 						if (weight)
 						{
-							auto account_weight (node.ledger.weight (transaction, account));
-							entry.put ("weight", account_weight.convert_to<std::string> ());
+							auto account_weight (transaction.weight (account));
+							response_l.put ("weight", account_weight.convert_to<std::string> ());
 						}
 						if (pending)
 						{
 							auto account_pending (node.ledger.account_pending (transaction, account));
-							entry.put ("pending", account_pending.convert_to<std::string> ());
+							response_l.put ("pending", account_pending.convert_to<std::string> ());
 						}
-						accounts.push_back (std::make_pair (account.to_account (), entry));
+						response_l.end ();
 					}
 				}
 			}
-			response_l.add_child ("accounts", accounts);
-			response (response_l);
+			response_l.end ();
+			response_l.finish ();
+			response_body (std::move (body_l));
 		}
 		else
 		{
@@ -3959,6 +4793,11 @@ void mol::rpc_handler::wallet_lock ()
 	}
 }
 
+void mol::rpc_handler::wallet_locked ()
+{
+	password_valid (true);
+}
+
 void mol::rpc_handler::wallet_pending ()
 {
 	std::string wallet_text (request.get<std::string> ("wallet"));
@@ -3992,7 +4831,7 @@ void mol::rpc_handler::wallet_pending ()
 			const bool source = request.get<bool> ("source", false);
 			boost::property_tree::ptree response_l;
 			boost::property_tree::ptree pending;
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
 			{
 				mol::account account (i->first.uint256 ());
@@ -4055,7 +4894,7 @@ void mol::rpc_handler::wallet_representative ()
 		auto existing (node.wallets.items.find (wallet));
 		if (existing != node.wallets.items.end ())
 		{
-			mol::transaction transaction (node.store.environment, nullptr, false);
+			read_transaction transaction (*this);
 			boost::property_tree::ptree response_l;
 			response_l.put ("representative", existing->second->store.representative (transaction).to_account ());
 			response (response_l);
@@ -4196,7 +5035,7 @@ void mol::rpc_handler::wallet_work_get ()
 			{
 				boost::property_tree::ptree response_l;
 				boost::property_tree::ptree works;
-				mol::transaction transaction (node.store.environment, nullptr, false);
+				read_transaction transaction (*this);
 				for (auto i (existing->second->store.begin (transaction)), n (existing->second->store.end ()); i != n; ++i)
 				{
 					mol::account account (i->first.uint256 ());
@@ -4307,7 +5146,7 @@ void mol::rpc_handler::work_get ()
 				auto error (account.decode_account (account_text));
 				if (!error)
 				{
-					mol::transaction transaction (node.store.environment, nullptr, false);
+					read_transaction transaction (*this);
 					auto account_check (existing->second->store.find (transaction, account));
 					if (account_check != existing->second->store.end ())
 					{
@@ -4936,7 +5775,7 @@ void mol::rpc_handler::asset_history () {
 	mol::block_hash hash;
 	auto head_str (request.get_optional<std::string> ("head"));
 
-	mol::transaction transaction (node.store.environment, nullptr, false);
+	read_transaction transaction (*this);
 	if (head_str) {
 
 		std::cout << "count 000000 ==== " << head_str << std::endl;
@@ -4999,10 +5838,16 @@ void mol::rpc_handler::asset_history () {
 			auto offset_text (request.get_optional<std::string> ("offset"));
 			if (!offset_text || !decode_unsigned (*offset_text, offset)) {
 
+				uint64_t height_start (0);
+				auto height_start_text (request.get_optional<std::string> ("height_start"));
+				if (height_start_text) {
+					error = decode_unsigned (*height_start_text, height_start);
+				}
 				boost::property_tree::ptree response_l;
 				boost::property_tree::ptree history;
 				if (!error) {
 
+					history_seek (transaction, hash, offset, height_start);
 					auto block (node.store.block_get (transaction, hash));
 					while (block != nullptr && count > 0) {
 
@@ -5044,7 +5889,7 @@ void mol::rpc_handler::asset_history () {
 
 				} else {
 
-					error_response (response, "Failed to decode head block hash");
+					error_response (response, "Invalid height_start");
 				}
 
 			} else {
@@ -5075,7 +5920,8 @@ void mol::rpc_handler::asset_info () {
 			const bool representative = request.get<bool>("representative", false);
 			const bool weight = request.get<bool>("weight", false);
 			const bool pending = request.get<bool>("pending", false);
-			mol::transaction transaction(node.store.environment, nullptr, false);
+			const bool supply = request.get<bool> ("supply", false);
+			read_transaction transaction (*this);
 			//mol::account_info info;
 			mol::asset_account_info info;
 			//if (!node.store.account_get(transaction, account, info)) {
@@ -5098,7 +5944,7 @@ void mol::rpc_handler::asset_info () {
 				}
 
 				if (weight) {
-					auto account_weight(node.ledger.weight(transaction, account));
+					auto account_weight(transaction.weight(account));
 					response_l.put("weight", account_weight.convert_to<std::string>());
 				}
 
@@ -5106,6 +5952,14 @@ void mol::rpc_handler::asset_info () {
 					auto account_pending(node.ledger.account_pending(transaction, account));
 					response_l.put("pending", account_pending.convert_to<std::string>());
 				}
+
+				if (supply) {
+					mol::asset_supply supply_l;
+					node.ledger.asset_supply_get (transaction, asset, supply_l);
+					response_l.put ("supply", supply_l.total.number ().convert_to<std::string> ());
+					response_l.put ("holders", std::to_string (supply_l.holders));
+					response_l.put ("supply_pending", supply_l.pending.number ().convert_to<std::string> ());
+				}
 				response(response_l);
 
 			} else {
@@ -5126,6 +5980,36 @@ void mol::rpc_handler::asset_info () {
 
 }
 
+void mol::rpc_handler::asset_supply () {
+
+	std::string asset_text (request.get<std::string> ("asset"));
+	mol::asset asset;
+	auto error (asset.decode_hex (asset_text));
+	if (!error) {
+
+		read_transaction transaction (*this);
+		mol::asset_supply supply;
+		if (!node.ledger.asset_supply_get (transaction, asset, supply)) {
+
+			boost::property_tree::ptree response_l;
+			response_l.put ("supply", supply.total.number ().convert_to<std::string> ());
+			response_l.put ("holders", std::to_string (supply.holders));
+			response_l.put ("pending", supply.pending.number ().convert_to<std::string> ());
+			response_l.put ("modified_timestamp", std::to_string (supply.modified));
+			response (response_l);
+
+		} else {
+
+			error_response (response, "Asset not found");
+		}
+
+	} else {
+
+		error_response (response, "Bad asset number");
+	}
+
+}
+
 void mol::rpc_handler::asset_send () {
 
 	//RPC control is disabled or not
@@ -5289,41 +6173,64 @@ void mol::rpc_handler::asset_pending () {
 		}
 
 		const bool source = request.get<bool> ("source", false);
-		boost::property_tree::ptree response_l;
-		boost::property_tree::ptree peers_l;
-		{
-			mol::transaction transaction (node.store.environment, nullptr, false);
-			mol::account end (account.number () + 1);
-			for (auto i (node.store.pending_begin (transaction, mol::pending_key (account, 0))), n (node.store.pending_begin (transaction, mol::pending_key (end, 0))); i != n && peers_l.size () < count; ++i) {
 
-				mol::pending_key key (i->first);
+		//只列出这个asset的pending
+		mol::asset asset (0);
+		boost::optional<std::string> asset_text (request.get_optional<std::string> ("asset"));
+		auto error_asset (asset_text.is_initialized () && asset.decode_hex (asset_text.get ()));
+		if (!error_asset) {
+
+			boost::property_tree::ptree response_l;
+			boost::property_tree::ptree peers_l;
+			auto add_entry ([&peers_l, &threshold, source](mol::block_hash const & hash_a, mol::pending_info const & info_a) {
+
 				if (threshold.is_zero () && !source) {
 
 					boost::property_tree::ptree entry;
-					entry.put ("", key.hash.to_string ());
+					entry.put ("", hash_a.to_string ());
 					peers_l.push_back (std::make_pair ("", entry));
 
-				} else {
+				} else if (info_a.amount.number () >= threshold.number ()) {
 
-					mol::pending_info info (i->second);
-					if (info.amount.number () >= threshold.number ()) {
+					if (source) {
+						boost::property_tree::ptree pending_tree;
+						pending_tree.put ("amount", info_a.amount.number ().convert_to<std::string> ());
+						pending_tree.put ("source", info_a.source.to_account ());
+						peers_l.add_child (hash_a.to_string (), pending_tree);
 
-						if (source) {
-							boost::property_tree::ptree pending_tree;
-							pending_tree.put ("amount", info.amount.number ().convert_to<std::string> ());
-							pending_tree.put ("source", info.source.to_account ());
-							peers_l.add_child (key.hash.to_string (), pending_tree);
+					} else {
 
-						} else {
+						peers_l.put (hash_a.to_string (), info_a.amount.number ().convert_to<std::string> ());
+					}
+				}
+			});
+			{
+				read_transaction transaction (*this);
+				if (!asset.is_zero ()) {
 
-							peers_l.put (key.hash.to_string (), info.amount.number ().convert_to<std::string> ());
+					node.ledger.asset_pending_for_each (transaction, account, asset, [&peers_l, &add_entry, count](mol::block_hash const & hash_a, mol::pending_info const & info_a) {
+						if (peers_l.size () < count) {
+							add_entry (hash_a, info_a);
 						}
+						return peers_l.size () < count;
+					});
+
+				} else {
+
+					mol::account end (account.number () + 1);
+					for (auto i (node.store.pending_begin (transaction, mol::pending_key (account, 0))), n (node.store.pending_begin (transaction, mol::pending_key (end, 0))); i != n && peers_l.size () < count; ++i) {
+
+						add_entry (mol::pending_key (i->first).hash, mol::pending_info (i->second));
 					}
 				}
 			}
+			response_l.add_child ("blocks", peers_l);
+			response (response_l);
+
+		} else {
+
+			error_response (response, "Bad asset number");
 		}
-		response_l.add_child ("blocks", peers_l);
-		response (response_l);
 
 	} else {
 
@@ -5335,7 +6242,15 @@ void mol::rpc_handler::asset_pending () {
 mol::rpc_connection::rpc_connection (mol::node & node_a, mol::rpc & rpc_a) :
 node (node_a.shared ()),
 rpc (rpc_a),
-socket (node_a.service)
+socket (node_a.service),
+timer (node_a.service),
+requests (0),
+keep_alive (false),
+chunked (false),
+idle_generation (0),
+chunk_writing (false),
+chunk_last (false),
+chunk_failed (false)
 {
 	responded.clear ();
 }
@@ -5345,17 +6260,22 @@ void mol::rpc_connection::parse_connection ()
 	read ();
 }
 
+void mol::rpc_connection::prepare_headers (unsigned version)
+{
+	res.set ("Content-Type", "application/json");
+	res.set ("Access-Control-Allow-Origin", "*");
+	res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
+	res.result (boost::beast::http::status::ok);
+	res.version (version);
+	res.keep_alive (keep_alive);
+}
+
 void mol::rpc_connection::write_result (std::string body, unsigned version)
 {
 	if (!responded.test_and_set ())
 	{
-		res.set ("Content-Type", "application/json");
-		res.set ("Access-Control-Allow-Origin", "*");
-		res.set ("Access-Control-Allow-Headers", "Accept, Accept-Language, Content-Language, Content-Type");
-		res.set ("Connection", "close");
-		res.result (boost::beast::http::status::ok);
-		res.body () = body;
-		res.version (version);
+		prepare_headers (version);
+		res.body () = std::move (body);
 		res.prepare_payload ();
 	}
 	else
@@ -5365,33 +6285,197 @@ void mol::rpc_connection::write_result (std::string body, unsigned version)
 	}
 }
 
+void mol::rpc_connection::write_chunk (std::string const & data_a, unsigned version)
+{
+	if (!chunked)
+	{
+		auto responded_l (responded.test_and_set ());
+		assert (!responded_l && "RPC already responded and should only respond once");
+		chunked = true;
+		prepare_headers (version);
+		res.chunked (true);
+		std::ostringstream header;
+		header << res.base ();
+		chunk_queue (header.str (), false);
+	}
+	if (!data_a.empty ())
+	{
+		std::ostringstream chunk;
+		chunk << std::hex << data_a.size () << "\r\n" << data_a << "\r\n";
+		chunk_queue (chunk.str (), false);
+	}
+}
+
+void mol::rpc_connection::write_chunk_last (std::string const & data_a, unsigned version)
+{
+	write_chunk (data_a, version);
+	chunk_queue ("0\r\n\r\n", true);
+}
+
+void mol::rpc_connection::chunk_queue (std::string && data_a, bool last_a)
+{
+	std::unique_lock<std::mutex> lock (chunk_mutex);
+	// Waiting keeps the handler from producing ahead of a slow client. It runs on an rpc worker, so the io_service is free
+	// to complete the writes and time out a stalled one.
+	auto room (chunk_condition.wait_for (lock, std::chrono::seconds (rpc.config.idle_timeout), [this]() { return chunks.size () < chunk_limit || chunk_failed; }));
+	if (!room)
+	{
+		// The idle timer closes the socket, the write in progress then drops the rest
+		chunk_failed = true;
+		keep_alive = false;
+	}
+	if (chunk_failed)
+	{
+		// Caught by process_request, which aborts the connection
+		throw std::runtime_error ("RPC response stream failed");
+	}
+	else
+	{
+		chunks.push_back (std::move (data_a));
+		chunk_last = last_a;
+		if (!chunk_writing)
+		{
+			chunk_writing = true;
+			auto this_l (shared_from_this ());
+			node->service.post ([this_l]() {
+				this_l->chunk_write ();
+			});
+		}
+	}
+}
+
+void mol::rpc_connection::chunk_write ()
+{
+	auto this_l (shared_from_this ());
+	std::string * data_l;
+	{
+		std::lock_guard<std::mutex> lock (chunk_mutex);
+		assert (chunk_writing && !chunks.empty ());
+		// Elements of a deque stay in place while others are pushed behind them
+		data_l = &chunks.front ();
+	}
+	idle_timer ();
+	write_buffer (boost::asio::buffer (*data_l), [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		this_l->chunk_written (ec);
+	});
+}
+
+void mol::rpc_connection::chunk_written (boost::system::error_code const & ec)
+{
+	++idle_generation;
+	timer.cancel ();
+	auto failed (false);
+	auto more (false);
+	auto finished (false);
+	{
+		std::lock_guard<std::mutex> lock (chunk_mutex);
+		chunks.pop_front ();
+		if (ec || chunk_failed)
+		{
+			chunk_failed = true;
+			chunks.clear ();
+			keep_alive = false;
+		}
+		failed = chunk_failed;
+		more = !chunks.empty ();
+		finished = !more && chunk_last;
+		// With nothing queued the next chunk_queue starts writing again
+		chunk_writing = more;
+	}
+	chunk_condition.notify_all ();
+	if (failed)
+	{
+		close ();
+	}
+	else if (more)
+	{
+		chunk_write ();
+	}
+	else if (finished && keep_alive)
+	{
+		next ();
+	}
+}
+
+void mol::rpc_connection::abort ()
+{
+	auto close_l (false);
+	{
+		std::lock_guard<std::mutex> lock (chunk_mutex);
+		chunk_failed = true;
+		keep_alive = false;
+		// A write in progress closes the connection when it completes, otherwise it's closed here
+		close_l = !chunk_writing;
+	}
+	chunk_condition.notify_all ();
+	if (close_l)
+	{
+		auto this_l (shared_from_this ());
+		node->service.post ([this_l]() {
+			this_l->close ();
+		});
+	}
+}
+
 void mol::rpc_connection::read ()
 {
 	auto this_l (shared_from_this ());
-	boost::beast::http::async_read (socket, buffer, request, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+	idle_timer ();
+	read_request ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+		++this_l->idle_generation;
+		this_l->timer.cancel ();
 		if (!ec)
 		{
-			this_l->node->background ([this_l]() {
+			// Requests on a connection are read one at a time, so pipelined ones wait in `buffer' and are answered in order
+			++this_l->requests;
+			this_l->keep_alive = this_l->request.keep_alive () && this_l->requests < this_l->rpc.config.keepalive_requests;
+			this_l->rpc.workers.push ([this_l]() {
 				auto start (std::chrono::steady_clock::now ());
 				auto version (this_l->request.version ());
-				auto response_handler ([this_l, version, start](boost::property_tree::ptree const & tree_a) {
-
-					std::stringstream ostream;
-					boost::property_tree::write_json (ostream, tree_a);
-					ostream.flush ();
-					auto body (ostream.str ());
-					this_l->write_result (body, version);
-					boost::beast::http::async_write (this_l->socket, this_l->res, [this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
-					});
+				auto body_handler ([this_l, version, start](std::string && body_a) {
+					if (!this_l->chunked)
+					{
+						this_l->write_result (std::move (body_a), version);
+						this_l->node->service.post ([this_l]() {
+							this_l->idle_timer ();
+							this_l->write_response ([this_l](boost::system::error_code const & ec, size_t bytes_transferred) {
+								++this_l->idle_generation;
+								this_l->timer.cancel ();
+								if (!ec && this_l->keep_alive)
+								{
+									this_l->next ();
+								}
+							});
+						});
+					}
+					else
+					{
+						this_l->write_chunk_last (body_a, version);
+					}
 
 					if (this_l->node->config.logging.log_rpc ())
 					{
 						BOOST_LOG (this_l->node->log) << boost::str (boost::format ("RPC request %2% completed in: %1% microseconds") % std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count () % boost::io::group (std::hex, std::showbase, reinterpret_cast<uintptr_t> (this_l.get ())));
 					}
 				});
+				auto response_handler ([body_handler](boost::property_tree::ptree const & tree_a) {
+					std::stringstream ostream;
+					boost::property_tree::write_json (ostream, tree_a);
+					ostream.flush ();
+					body_handler (ostream.str ());
+				});
 				if (this_l->request.method () == boost::beast::http::verb::post)
 				{
-					auto handler (std::make_shared<mol::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler));
+					auto handler (std::make_shared<mol::rpc_handler> (*this_l->node, this_l->rpc, this_l->request.body (), response_handler, body_handler));
+					if (version >= 11)
+					{
+						handler->response_chunk = [this_l, version](std::string const & data_a) {
+							this_l->write_chunk (data_a, version);
+						};
+						handler->response_abort = [this_l]() {
+							this_l->abort ();
+						};
+					}
 					handler->process_request ();
 				}
 				else
@@ -5400,13 +6484,61 @@ void mol::rpc_connection::read ()
 				}
 			});
 		}
-		else
+		else if (ec != boost::beast::http::error::end_of_stream && ec != boost::asio::error::operation_aborted)
 		{
 			BOOST_LOG (this_l->node->log) << "RPC read error: " << ec.message ();
 		}
 	});
 }
 
+void mol::rpc_connection::next ()
+{
+	request = boost::beast::http::request<boost::beast::http::string_body> ();
+	res = boost::beast::http::response<boost::beast::http::string_body> ();
+	responded.clear ();
+	chunked = false;
+	chunk_last = false;
+	read ();
+}
+
+void mol::rpc_connection::idle_timer ()
+{
+	std::weak_ptr<mol::rpc_connection> this_w (shared_from_this ());
+	auto generation (idle_generation.load ());
+	// Rearming cancels the previous wait, so a connection has at most one pending
+	timer.expires_after (std::chrono::seconds (rpc.config.idle_timeout));
+	timer.async_wait ([this_w, generation](boost::system::error_code const & ec) {
+		auto this_l (this_w.lock ());
+		// The read or write hasn't completed since the timer was armed, close the connection to cancel it. The wait completes
+		// on the io_service like the read, so the socket isn't closed from another thread.
+		if (!ec && this_l != nullptr && this_l->idle_generation == generation)
+		{
+			this_l->close ();
+		}
+	});
+}
+
+void mol::rpc_connection::read_request (std::function<void(boost::system::error_code const &, size_t)> const & callback_a)
+{
+	boost::beast::http::async_read (socket, buffer, request, callback_a);
+}
+
+void mol::rpc_connection::write_response (std::function<void(boost::system::error_code const &, size_t)> const & callback_a)
+{
+	boost::beast::http::async_write (socket, res, callback_a);
+}
+
+void mol::rpc_connection::write_buffer (boost::asio::const_buffer const & buffer_a, std::function<void(boost::system::error_code const &, size_t)> const & callback_a)
+{
+	boost::asio::async_write (socket, buffer_a, callback_a);
+}
+
+void mol::rpc_connection::close ()
+{
+	boost::system::error_code ignored;
+	socket.close (ignored);
+}
+
 namespace
 {
 void reprocess_body (std::string & body, boost::property_tree::ptree & tree_a)
@@ -5423,471 +6555,103 @@ void mol::rpc_handler::process_request ()
 	{
 		std::stringstream istream (body);
 		boost::property_tree::read_json (istream, request);
-		std::string action (request.get<std::string> ("action"));
-		if (action == "password_enter")
-		{
-			password_enter ();
-			request.erase ("password");
-			reprocess_body (body, request);
-		}
-		else if (action == "password_change")
-		{
-			password_change ();
-			request.erase ("password");
-			reprocess_body (body, request);
-		}
-		else if (action == "wallet_unlock")
-		{
-			password_enter ();
-			request.erase ("password");
-			reprocess_body (body, request);
-		}
-		if (node.config.logging.log_rpc ())
-		{
-			BOOST_LOG (node.log) << body;
-		}
-		if (action == "account_balance")
-		{
-			account_balance ();
-		}
-		else if (action == "account_block_count")
-		{
-			account_block_count ();
-		}
-		else if (action == "account_create")
-		{
-			account_create ();
-		}
-		else if (action == "account_get")
+		auto first (body.find_first_not_of (" \t\r\n"));
+		if (first != std::string::npos && body[first] == '[')
 		{
-			account_get ();
+			// A bare array of requests is shorthand for the batch action
+			boost::property_tree::ptree envelope;
+			envelope.put ("action", "batch");
+			envelope.add_child ("requests", request);
+			request.swap (envelope);
 		}
-		else if (action == "account_history")
-		{
-			account_history ();
-		}
-		else if (action == "account_info")
-		{
-			account_info ();
-		}
-		else if (action == "account_key")
-		{
-			account_key ();
-		}
-		else if (action == "account_list")
-		{
-			account_list ();
-		}
-		else if (action == "account_move")
-		{
-			account_move ();
-		}
-		else if (action == "account_remove")
-		{
-			account_remove ();
-		}
-		else if (action == "account_representative")
-		{
-			account_representative ();
-		}
-		else if (action == "account_representative_set")
-		{
-			account_representative_set ();
-		}
-		else if (action == "account_weight")
-		{
-			account_weight ();
-		}
-		else if (action == "accounts_balances")
-		{
-			accounts_balances ();
-		}
-		else if (action == "accounts_create")
-		{
-			accounts_create ();
-		}
-		else if (action == "accounts_frontiers")
-		{
-			accounts_frontiers ();
-		}
-		else if (action == "accounts_pending")
-		{
-			accounts_pending ();
-		}
-		else if (action == "available_supply")
-		{
-			available_supply ();
-		}
-		else if (action == "block")
-		{
-			block ();
-		}
-		else if (action == "block_confirm")
-		{
-			block_confirm ();
-		}
-		else if (action == "blocks")
-		{
-			blocks ();
-		}
-		else if (action == "blocks_info")
-		{
-			blocks_info ();
-		}
-		else if (action == "block_account")
-		{
-			block_account ();
-		}
-		else if (action == "block_count")
-		{
-			block_count ();
-		}
-		else if (action == "block_count_type")
-		{
-			block_count_type ();
-		}
-		else if (action == "block_create")
-		{
-			block_create ();
-
-		} else if (action == "asset_create") {
-
-			asset_create();
-
-		} else if (action == "asset_history") {
-
-			asset_history();
-
-		} else if (action == "asset_info") {
-
-			asset_info();
-
-		} else if (action == "block_hash")
-		{
-			block_hash ();
-		}
-		else if (action == "successors")
-		{
-			successors ();
-		}
-		else if (action == "bootstrap")
-		{
-			bootstrap ();
-		}
-		else if (action == "bootstrap_any")
-		{
-			bootstrap_any ();
-		}
-		else if (action == "chain")
-		{
-			chain ();
-		}
-		else if (action == "delegators")
-		{
-			delegators ();
-		}
-		else if (action == "delegators_count")
-		{
-			delegators_count ();
-		}
-		else if (action == "deterministic_key")
-		{
-			deterministic_key ();
-		}
-		else if (action == "confirmation_history")
-		{
-			confirmation_history ();
-		}
-		else if (action == "frontiers")
-		{
-			frontiers ();
-		}
-		else if (action == "frontier_count")
-		{
-			frontier_count ();
-		}
-		else if (action == "history")
-		{
-			request.put ("head", request.get<std::string> ("hash"));
-			account_history ();
-		}
-		else if (action == "keepalive")
-		{
-			keepalive ();
-		}
-		else if (action == "key_create")
-		{
-			key_create ();
-		}
-		else if (action == "key_expand")
-		{
-			key_expand ();
-		}
-		else if (action == "kmol_from_raw")
-		{
-			kmol_from_raw ();
-		}
-		else if (action == "kmol_to_raw")
-		{
-			kmol_to_raw ();
-		}
-		else if (action == "ledger")
-		{
-			ledger ();
-		}
-		else if (action == "mmol_from_raw")
-		{
-			mmol_from_raw ();
-		}
-		else if (action == "mmol_to_raw")
-		{
-			mmol_to_raw ();
-		}
-		else if (action == "password_change")
-		{
-			// Processed before logging
-		}
-		else if (action == "password_enter")
-		{
-			// Processed before logging
-		}
-		else if (action == "password_valid")
-		{
-			password_valid ();
-		}
-		else if (action == "payment_begin")
-		{
-			payment_begin ();
-		}
-		else if (action == "payment_init")
-		{
-			payment_init ();
-		}
-		else if (action == "payment_end")
-		{
-			payment_end ();
-		}
-		else if (action == "payment_wait")
-		{
-			payment_wait ();
-		}
-		else if (action == "peers")
-		{
-			peers ();
-		}
-		else if (action == "pending")
-		{
-			pending ();
-		}
-		else if (action == "pending_exists")
-		{
-			pending_exists ();
-		}
-		else if (action == "process")
-		{
-			process ();
-		}
-		else if (action == "mol_from_raw")
-		{
-			mol_from_raw ();
-		}
-		else if (action == "mol_to_raw")
-		{
-			mol_to_raw ();
-		}
-		else if (action == "receive")
-		{
-			receive ();
-		}
-		else if (action == "receive_minimum")
-		{
-			receive_minimum ();
-		}
-		else if (action == "receive_minimum_set")
-		{
-			receive_minimum_set ();
-		}
-		else if (action == "representatives")
-		{
-			representatives ();
-		}
-		else if (action == "representatives_online")
-		{
-			representatives_online ();
-		}
-		else if (action == "republish")
-		{
-			republish ();
-		}
-		else if (action == "search_pending")
-		{
-			search_pending ();
-		}
-		else if (action == "search_pending_all")
-		{
-			search_pending_all ();
-		}
-		else if (action == "send")
-		{
-			send ();
-		}
-		else if (action == "stats")
-		{
-			stats ();
-		}
-		else if (action == "stop")
-		{
-			stop ();
-		}
-		else if (action == "unchecked")
-		{
-			unchecked ();
-		}
-		else if (action == "unchecked_clear")
-		{
-			unchecked_clear ();
-		}
-		else if (action == "unchecked_get")
-		{
-			unchecked_get ();
-		}
-		else if (action == "unchecked_keys")
-		{
-			unchecked_keys ();
-		}
-		else if (action == "validate_account_number")
-		{
-			validate_account_number ();
-		}
-		else if (action == "version")
-		{
-			version ();
-		}
-		else if (action == "wallet_add")
-		{
-			wallet_add ();
-		}
-		else if (action == "wallet_add_watch")
-		{
-			wallet_add_watch ();
-		}
-		else if (action == "wallet_balance_total")
-		{
-			wallet_balance_total ();
-		}
-		else if (action == "wallet_balances")
-		{
-			wallet_balances ();
-		}
-		else if (action == "wallet_change_seed")
-		{
-			wallet_change_seed ();
-		}
-		else if (action == "wallet_contains")
-		{
-			wallet_contains ();
-		}
-		else if (action == "wallet_create")
-		{
-			wallet_create ();
-		}
-		else if (action == "wallet_destroy")
-		{
-			wallet_destroy ();
-		}
-		else if (action == "wallet_export")
-		{
-			wallet_export ();
-		}
-		else if (action == "wallet_frontiers")
-		{
-			wallet_frontiers ();
-		}
-		else if (action == "wallet_key_valid")
-		{
-			wallet_key_valid ();
-		}
-		else if (action == "wallet_ledger")
-		{
-			wallet_ledger ();
-		}
-		else if (action == "wallet_lock")
-		{
-			wallet_lock ();
-		}
-		else if (action == "wallet_locked")
-		{
-			password_valid (true);
-		}
-		else if (action == "wallet_pending")
-		{
-			wallet_pending ();
-		}
-		else if (action == "wallet_representative")
-		{
-			wallet_representative ();
-		}
-		else if (action == "wallet_representative_set")
-		{
-			wallet_representative_set ();
-		}
-		else if (action == "wallet_republish")
-		{
-			wallet_republish ();
-		}
-		else if (action == "wallet_unlock")
-		{
-			// Processed before logging
-		}
-		else if (action == "wallet_work_get")
-		{
-			wallet_work_get ();
-		}
-		else if (action == "work_generate")
-		{
-			work_generate ();
-		}
-		else if (action == "work_cancel")
-		{
-			work_cancel ();
-		}
-		else if (action == "work_get")
-		{
-			work_get ();
-		}
-		else if (action == "work_set")
+		std::string action (request.get<std::string> ("action"));
+		auto index (rpc_action_find (action));
+		if (index != rpc_actions_size)
 		{
-			work_set ();
+			auto & action_l (rpc_actions[index]);
+			auto admission (std::make_shared<rpc_admission> (rpc, index, action_l.cost));
+			if (action_l.control && !rpc.config.enable_control)
+			{
+				rpc.action_stats.reject (index);
+				error_response (response, "RPC control is disabled");
+			}
+			else if (batched && !action_l.read_only)
+			{
+				rpc.action_stats.reject (index);
+				error_response (response, "Only read only actions can be batched");
+			}
+			else if (!admission->admitted)
+			{
+				rpc.action_stats.reject (index);
+				error_response (response, "Too many heavy requests in progress");
+			}
+			else
+			{
+				auto response_l (response);
+				response = [admission, response_l](boost::property_tree::ptree const & tree_a) {
+					response_l (tree_a);
+					admission->complete ();
+				};
+				auto response_body_l (response_body);
+				response_body = [admission, response_body_l](std::string && body_a) {
+					response_body_l (std::move (body_a));
+					admission->complete ();
+				};
+				if (response_chunk)
+				{
+					auto response_chunk_l (response_chunk);
+					response_chunk = [this, response_chunk_l](std::string const & data_a) {
+						streaming = true;
+						response_chunk_l (data_a);
+					};
+				}
+				if (action_l.redact)
+				{
+					(this->*action_l.handler) ();
+					request.erase ("password");
+					reprocess_body (body, request);
+				}
+				if (node.config.logging.log_rpc ())
+				{
+					BOOST_LOG (node.log) << body;
+				}
+				if (!action_l.redact)
+				{
+					(this->*action_l.handler) ();
+				}
+			}
 		}
-		else if (action == "work_validate")
+		else
 		{
-			work_validate ();
+			if (node.config.logging.log_rpc ())
+			{
+				BOOST_LOG (node.log) << body;
+			}
+			error_response (response, "Unknown command");
 		}
-		else if (action == "work_peer_add")
+	}
+	catch (std::runtime_error const & err)
+	{
+		if (streaming)
 		{
-			work_peer_add ();
+			response_abort ();
 		}
-		else if (action == "work_peers")
+		else
 		{
-			work_peers ();
+			error_response (response, "Unable to parse JSON");
 		}
-		else if (action == "work_peers_clear")
+	}
+	catch (...)
+	{
+		if (streaming)
 		{
-			work_peers_clear ();
+			response_abort ();
 		}
 		else
 		{
-			error_response (response, "Unknown command");
+			error_response (response, "Internal server error in RPC");
 		}
 	}
-	catch (std::runtime_error const & err)
-	{
-		error_response (response, "Unable to parse JSON");
-	}
-	catch (...)
-	{
-		error_response (response, "Internal server error in RPC");
-	}
 }
 
 mol::payment_observer::payment_observer (std::function<void(boost::property_tree::ptree const &)> const & response_a, mol::rpc & rpc_a, mol::account const & account_a, mol::amount const & amount_a) :
@@ -1,17 +1,52 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <mol/node/utility.hpp>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 namespace mol
 {
 void error_response (std::function<void(boost::property_tree::ptree const &)> response_a, std::string const & message_a);
 class node;
+/**
+ * Streams a JSON document into a string in the layout boost::property_tree::write_json produces, without building a ptree.
+ * Objects and arrays without members are written as "", as write_json writes an empty ptree.
+ */
+class json_writer
+{
+public:
+	json_writer (std::string &);
+	/** Passes the output to the function and clears it each time more than chunk_size bytes are buffered */
+	json_writer (std::string &, std::function<void(std::string const &)> const &);
+	void put (std::string const &, std::string const &);
+	void push (std::string const &);
+	void begin_object (std::string const &);
+	void begin_object ();
+	void begin_array (std::string const &);
+	void end ();
+	void finish ();
+	std::string & string;
+	static size_t constexpr chunk_size = 64 * 1024;
+
+private:
+	void member (std::string const &);
+	void element ();
+	void value (std::string const &);
+	// Closing bracket of each open scope and whether its opening bracket has been written yet
+	std::vector<std::pair<char, bool>> scopes;
+	std::function<void(std::string const &)> chunk;
+};
 /** Configuration options for RPC TLS */
 class rpc_secure_config
 {
@@ -47,6 +82,14 @@ public:
 	bool enable_control;
 	uint64_t frontier_request_limit;
 	uint64_t chain_request_limit;
+	/** Number of heavy requests processed at once, further ones are refused until one finishes. 0 disables the limit */
+	uint64_t heavy_request_limit;
+	/** Seconds a connection may wait for its next request before it's closed */
+	uint64_t idle_timeout;
+	/** Requests served on one connection before it's closed, 1 disables keep-alive */
+	uint64_t keepalive_requests;
+	/** Threads running request handlers, a streaming handler holds one while its client is slow to read */
+	unsigned worker_threads;
 	rpc_secure_config secure;
 };
 enum class payment_status
@@ -59,6 +102,50 @@ enum class payment_status
 	//success_fork, // Amount received but it involved a fork
 	success // Amount received
 };
+/** Relative cost of an RPC action, heavy ones are subject to admission control */
+enum class rpc_cost : uint8_t
+{
+	light,
+	medium,
+	heavy
+};
+/** Requests, refusals and handler time per RPC action, indexed like the dispatch table in rpc.cpp */
+class rpc_action_stats
+{
+public:
+	rpc_action_stats ();
+	void add (size_t, std::chrono::steady_clock::duration const &);
+	void reject (size_t);
+	uint64_t count (size_t) const;
+	uint64_t rejected (size_t) const;
+	uint64_t microseconds (size_t) const;
+	static size_t constexpr actions = 111;
+
+private:
+	std::array<std::atomic<uint64_t>, actions> counts;
+	std::array<std::atomic<uint64_t>, actions> rejections;
+	std::array<std::atomic<uint64_t>, actions> times;
+};
+/**
+ * Threads outside of the io_service that run request handlers.
+ * Streaming handlers wait here for the socket to take their chunks, the io_service stays free to complete the writes.
+ */
+class rpc_workers
+{
+public:
+	rpc_workers (unsigned);
+	~rpc_workers ();
+	void push (std::function<void()> const &);
+	void stop ();
+
+private:
+	void run ();
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::function<void()>> tasks;
+	bool stopped;
+	std::vector<std::thread> threads;
+};
 class wallet;
 class payment_observer;
 class rpc
@@ -74,6 +161,9 @@ public:
 	std::unordered_map<mol::account, std::shared_ptr<mol::payment_observer>> payment_observers;
 	mol::rpc_config config;
 	mol::node & node;
+	mol::rpc_workers workers;
+	mol::rpc_action_stats action_stats;
+	std::atomic<uint64_t> heavy_requests;
 	bool on;
 	static uint16_t const rpc_port = mol::mol_network == mol::mol_networks::mol_live_network ? 17076 : 55000;
 };
@@ -84,13 +174,62 @@ public:
 	virtual void parse_connection ();
 	virtual void read ();
 	virtual void write_result (std::string body, unsigned version);
+	/**
+	 * Queues part of a chunked response, waiting while chunk_limit chunks are still unwritten.
+	 * Throws once the response can't be completed so the handler stops producing it.
+	 */
+	virtual void write_chunk (std::string const &, unsigned);
+	/** Queues the remaining body and the end of a chunked response */
+	virtual void write_chunk_last (std::string const &, unsigned);
+	/** Drops a chunked response that failed part way and closes the connection, the client can't be sent a valid body anymore */
+	void abort ();
+	void prepare_headers (unsigned);
+	/** Resets the request state and reads the next request on a kept alive connection */
+	void next ();
+	/** Closes the connection if the pending read or write doesn't complete within the idle timeout */
+	void idle_timer ();
+	void chunk_queue (std::string &&, bool);
+	/** Writes the oldest queued chunk, runs on the io_service */
+	void chunk_write ();
+	void chunk_written (boost::system::error_code const &);
+	/*
+	 * Transport for the connection, every read and write goes through these. A TLS connection overrides them
+	 * to use its stream so kept alive and chunked responses are encrypted like the first one.
+	 */
+	/** Reads the next request into `request' */
+	virtual void read_request (std::function<void(boost::system::error_code const &, size_t)> const &);
+	/** Writes `res' including its headers */
+	virtual void write_response (std::function<void(boost::system::error_code const &, size_t)> const &);
+	/** Writes raw bytes, used for chunked bodies. The buffer stays valid until the callback runs. */
+	virtual void write_buffer (boost::asio::const_buffer const &, std::function<void(boost::system::error_code const &, size_t)> const &);
+	/** Closes the transport, cancelling any pending read or write */
+	virtual void close ();
 	std::shared_ptr<mol::node> node;
 	mol::rpc & rpc;
 	boost::asio::ip::tcp::socket socket;
+	boost::asio::steady_timer timer;
 	boost::beast::flat_buffer buffer;
 	boost::beast::http::request<boost::beast::http::string_body> request;
 	boost::beast::http::response<boost::beast::http::string_body> res;
 	std::atomic_flag responded;
+	uint64_t requests;
+	// Whether the connection stays open after the current response
+	bool keep_alive;
+	// Whether the current response is being sent with chunked transfer encoding
+	bool chunked;
+	// Bumped whenever a read or write completes, an idle timer only closes the connection if it's unchanged
+	std::atomic<uint64_t> idle_generation;
+	std::mutex chunk_mutex;
+	std::condition_variable chunk_condition;
+	// Framed chunks waiting to be written, the front one is being written while chunk_writing is set
+	std::deque<std::string> chunks;
+	bool chunk_writing;
+	// Whether the end of the response is queued
+	bool chunk_last;
+	// Set when a chunk write fails or the response is aborted, later chunks are dropped
+	bool chunk_failed;
+	// Chunks a handler can get ahead of the socket before it waits, bounding the memory a slow client can hold
+	static size_t constexpr chunk_limit = 4;
 };
 class payment_observer : public std::enable_shared_from_this<mol::payment_observer>
 {
@@ -112,6 +251,8 @@ public:
 class rpc_handler : public std::enable_shared_from_this<mol::rpc_handler>
 {
 public:
+	rpc_handler (mol::node &, mol::rpc &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &, std::function<void(std::string &&)> const &);
+	// Bodies a handler serializes itself are parsed back into a tree and passed to the response function
 	rpc_handler (mol::node &, mol::rpc &, std::string const &, std::function<void(boost::property_tree::ptree const &)> const &);
 	void process_request ();
 	void account_balance ();
@@ -132,6 +273,7 @@ public:
 	void accounts_frontiers ();
 	void accounts_pending ();
 	void available_supply ();
+	void batch ();
 	void block ();
 	void block_confirm ();
 	void blocks ();
@@ -161,6 +303,7 @@ public:
 	void mmol_from_raw ();
 	void password_change ();
 	void password_enter ();
+	void password_valid ();
 	void password_valid (bool wallet_locked);
 	void payment_begin ();
 	void payment_init ();
@@ -203,6 +346,7 @@ public:
 	void wallet_key_valid ();
 	void wallet_ledger ();
 	void wallet_lock ();
+	void wallet_locked ();
 	void wallet_pending ();
 	void wallet_representative ();
 	void wallet_representative_set ();
@@ -219,13 +363,27 @@ public:
 	void asset_create();
 	void asset_history();
 	void asset_info ();
+	void asset_supply ();
 	void asset_send ();
 	void asset_pending ();
+	void history_seek (MDB_txn *, mol::block_hash &, uint64_t &, uint64_t);
 	std::string body;
 	mol::node & node;
 	mol::rpc & rpc;
 	boost::property_tree::ptree request;
 	std::function<void(boost::property_tree::ptree const &)> response;
+	// Takes a body already serialized with mol::json_writer
+	std::function<void(std::string &&)> response_body;
+	// Sends the start of a body while it's still being produced, unset if the connection can't stream. The rest follows through response_body
+	std::function<void(std::string const &)> response_chunk;
+	// Ends the connection when a streamed response fails after its start was sent, as an error body can't follow it
+	std::function<void()> response_abort;
+	// Whether response_chunk has sent part of the body
+	bool streaming;
+	// Read transaction shared by the requests of a sequential batch, read handlers use it instead of opening their own
+	MDB_txn * batch_transaction;
+	// Set on requests run as part of a batch, which are restricted to read only actions
+	bool batched;
 };
 /** Returns the correct RPC implementation based on TLS configuration */
 std::unique_ptr<mol::rpc> get_rpc (boost::asio::io_service & service_a, mol::node & node_a, mol::rpc_config const & config_a);